@@ -2,8 +2,10 @@
 
 #include <cstdio>
 #include <cstring>
+#include <ostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 template<typename T>
 struct ArgConverter {
@@ -19,38 +21,54 @@ struct ArgConverter<std::string> {
 	}
 };
 
+/*
+ * Generated code is appended to an in-memory buffer. With a sink the buffer is written out whenever it grows past
+ * flushSize, otherwise it accumulates until get().
+ */
 struct CodeGen {
 	static constexpr char const *const indentString = "   ";
+	static constexpr size_t flushSize = size_t(1) << 16;
 	CodeGen() {
 		indentCount = 0;
+		sink = nullptr;
+		formatBuffer.resize(256);
 	}
-	std::string getIndention() const {
-		std::string str;
-		for (int n = 0; n < indentCount; n++) {
-			str += indentString;
+	CodeGen(std::ostream &os) :
+			CodeGen() {
+		sink = &os;
+		generatedCode.reserve(2 * flushSize);
+	}
+	CodeGen(CodeGen const&) = delete;
+	CodeGen& operator=(CodeGen const&) = delete;
+	~CodeGen() {
+		flush();
+	}
+	std::string const& getIndention() {
+		while (int(indentCache.size()) <= indentCount) {
+			indentCache.push_back(indentCache.empty() ? std::string() : indentCache.back() + indentString);
 		}
-		return str;
+		return indentCache[indentCount];
 	}
 	void stringToFile(std::string const str) {
-		generatedCode += "\n" + str + "\n";
+		generatedCode += "\n";
+		generatedCode += str;
+		generatedCode += "\n";
+		bufferCheck();
 	}
 	void print(std::string const &line) {
-		if (line[0] != '#' && line.back() != ':') {
-			generatedCode += getIndention();
-		}
-		generatedCode += line;
-		generatedCode += "\n";
+		printLine(line.data(), line.size());
 	}
 	template<typename ... Args>
 	void print(std::string const &fmt, Args &&...args) {
-		char *buffer;
-		int const rc = asprintf(&buffer, fmt.c_str(), ArgConverter<typename std::decay<Args>::type>::convert(std::forward<Args>(args))...);
+		int rc;
+		while ((rc = std::snprintf(formatBuffer.data(), formatBuffer.size(), fmt.c_str(),
+				ArgConverter<typename std::decay<Args>::type>::convert(std::forward<Args>(args))...)) >= int(formatBuffer.size())) {
+			formatBuffer.resize(rc + 1);
+		}
 		if (rc < 0) {
-			throw std::runtime_error("Error in asprintf call.\n");
+			throw std::runtime_error("Error in snprintf call.\n");
 		}
-		std::string const line(buffer);
-		print(line);
-		free(buffer);
+		printLine(formatBuffer.data(), size_t(rc));
 	}
 	void indent() {
 		indentCount++;
@@ -63,10 +81,21 @@ struct CodeGen {
 			generatedCode += getIndention();
 			generatedCode += "\n";
 		}
+		bufferCheck();
 	}
 	std::string get() const {
 		return generatedCode;
 	}
+	void splice(std::string const &text) {
+		generatedCode += text;
+		bufferCheck();
+	}
+	void flush() {
+		if (sink && !generatedCode.empty()) {
+			sink->write(generatedCode.data(), generatedCode.size());
+			generatedCode.clear();
+		}
+	}
 	void sectionComment(std::string const &comment) {
 		generatedCode += "/******************************************************************************/\n/* " + comment;
 		for (unsigned i = 0; i < 75 - comment.size(); i++) {
@@ -74,9 +103,25 @@ struct CodeGen {
 		}
 		generatedCode += "*/\n";
 		generatedCode += "/******************************************************************************/\n\n";
+		bufferCheck();
 	}
 private:
+	void printLine(char const *line, size_t length) {
+		if (length == 0 || (line[0] != '#' && line[length - 1] != ':')) {
+			generatedCode += getIndention();
+		}
+		generatedCode.append(line, length);
+		generatedCode += "\n";
+		bufferCheck();
+	}
+	void bufferCheck() {
+		if (sink && generatedCode.size() >= flushSize) {
+			flush();
+		}
+	}
 	int indentCount;
+	std::ostream *sink;
 	std::string generatedCode;
+	std::vector<char> formatBuffer;
+	std::vector<std::string> indentCache;
 };
-
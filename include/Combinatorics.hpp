@@ -8,7 +8,14 @@
 #ifndef INCLUDE_COMBINATORICS_HPP_
 #define INCLUDE_COMBINATORICS_HPP_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 constexpr size_t factorial(size_t n) {
 	if (n) {
@@ -18,4 +25,141 @@ constexpr size_t factorial(size_t n) {
 	}
 }
 
+/* Arbitrary precision unsigned integer, just enough to form products of small factors exactly. */
+struct BigUnsigned {
+	BigUnsigned(uint64_t value = 0) {
+		while (value) {
+			limbs.push_back(uint32_t(value));
+			value >>= 32;
+		}
+	}
+	BigUnsigned& operator*=(uint32_t factor) {
+		uint64_t carry = 0;
+		for (auto &limb : limbs) {
+			uint64_t const product = uint64_t(limb) * factor + carry;
+			limb = uint32_t(product);
+			carry = product >> 32;
+		}
+		if (carry) {
+			limbs.push_back(uint32_t(carry));
+		}
+		if (!factor) {
+			limbs.clear();
+		}
+		return *this;
+	}
+	bool operator==(BigUnsigned const&) const = default;
+	bool fits64() const {
+		return limbs.size() <= 2;
+	}
+	uint64_t toU64() const {
+		if (!fits64()) {
+			throw std::overflow_error("BigUnsigned value does not fit in 64 bits.\n");
+		}
+		uint64_t value = 0;
+		for (size_t n = limbs.size(); n > 0; n--) {
+			value = (value << 32) | limbs[n - 1];
+		}
+		return value;
+	}
+	std::string toString() const {
+		std::string digits;
+		std::vector<uint32_t> quotient = limbs;
+		while (!quotient.empty()) {
+			uint64_t remainder = 0;
+			for (size_t n = quotient.size(); n > 0; n--) {
+				uint64_t const current = (remainder << 32) | quotient[n - 1];
+				quotient[n - 1] = uint32_t(current / 10);
+				remainder = current % 10;
+			}
+			digits += char('0' + remainder);
+			while (!quotient.empty() && !quotient.back()) {
+				quotient.pop_back();
+			}
+		}
+		if (digits.empty()) {
+			digits = "0";
+		}
+		std::reverse(digits.begin(), digits.end());
+		return digits;
+	}
+	std::vector<uint32_t> limbs;
+};
+
+/* Prime factorizations of 1..maxValue from a smallest-prime-factor sieve, stored as (prime index, exponent) runs. */
+struct PrimeFactorTable {
+	PrimeFactorTable(size_t maxValue) {
+		std::vector<uint32_t> smallest(maxValue + 1, 0);
+		for (size_t n = 2; n <= maxValue; n++) {
+			if (!smallest[n]) {
+				primeIndex.resize(n + 1, 0);
+				primeIndex[n] = primes.size();
+				primes.push_back(n);
+				for (size_t m = n; m <= maxValue; m += n) {
+					if (!smallest[m]) {
+						smallest[m] = n;
+					}
+				}
+			}
+		}
+		offsets.assign(3, 0);
+		for (size_t n = 2; n <= maxValue; n++) {
+			size_t m = n;
+			while (m > 1) {
+				uint32_t const p = smallest[m];
+				uint32_t exponent = 0;
+				while (m % p == 0) {
+					m /= p;
+					exponent++;
+				}
+				factorList.emplace_back(primeIndex[p], exponent);
+			}
+			offsets.push_back(factorList.size());
+		}
+	}
+	size_t primeCount() const {
+		return primes.size();
+	}
+	size_t maxValue() const {
+		return offsets.size() - 2;
+	}
+	std::span<std::pair<uint32_t, uint32_t> const> factors(size_t n) const {
+		return std::span<std::pair<uint32_t, uint32_t> const>(factorList.data() + offsets[n], offsets[n + 1] - offsets[n]);
+	}
+	void accumulate(std::vector<int> &exponents, size_t n, int sign) const {
+		for (auto const &[index, exponent] : factors(n)) {
+			exponents[index] += sign * int(exponent);
+		}
+	}
+	/* Multiplies out prime^exponent in 64 bits while it fits and with BigUnsigned after that. */
+	BigUnsigned evaluate(std::vector<int> const &exponents) const {
+		uint64_t product = 1;
+		bool overflow = false;
+		BigUnsigned big;
+		for (size_t i = 0; i < exponents.size(); i++) {
+			if (exponents[i] < 0) {
+				throw std::logic_error("Negative prime exponent in an integral product.\n");
+			}
+			for (int e = 0; e < exponents[i]; e++) {
+				uint64_t next;
+				if (overflow) {
+					big *= primes[i];
+				} else if (__builtin_mul_overflow(product, uint64_t(primes[i]), &next)) {
+					overflow = true;
+					big = BigUnsigned(product);
+					big *= primes[i];
+				} else {
+					product = next;
+				}
+			}
+		}
+		return overflow ? big : BigUnsigned(product);
+	}
+private:
+	std::vector<uint32_t> primes;
+	std::vector<uint32_t> primeIndex;
+	std::vector<std::pair<uint32_t, uint32_t>> factorList;
+	std::vector<size_t> offsets;
+};
+
 #endif /* INCLUDE_COMBINATORICS_HPP_ */
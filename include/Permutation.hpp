@@ -10,12 +10,21 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <numeric>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+
 template<typename T>
 concept RandomAccess = requires(T a, size_t i) {
 	{a[i]}-> std::convertible_to<typename T::value_type>;
@@ -39,7 +48,7 @@ struct Permutation: public std::array<size_t, N> {
 		base_type const &P = *this;
 		Permutation I;
 		for (size_t n = 0; n < N; n++) {
-			I[P[n] - 1] = P[n];
+			I[P[n] - 1] = n + 1;
 		}
 		return I;
 	}
@@ -71,23 +80,56 @@ struct Permutation: public std::array<size_t, N> {
 		*this = *this / B;
 		return *this;
 	}
-	size_t cycleLength() const {
-		Permutation<N> Q = identity;
+	/* Cycle lengths in descending order, zero padded, from one pass and a counting sort over the lengths. */
+	std::array<size_t, N> cycleType() const {
+		base_type const &P = *this;
+		std::array<size_t, N + 1> histogram = { };
+		std::array<bool, N> visited = { };
+		for (size_t n = 0; n < N; n++) {
+			if (!visited[n]) {
+				size_t length = 0;
+				for (size_t m = n; !visited[m]; m = P[m] - 1) {
+					visited[m] = true;
+					length++;
+				}
+				histogram[length]++;
+			}
+		}
+		std::array<size_t, N> lengths = { };
 		size_t count = 0;
-		do {
-			Q = *this * Q;
-			count++;
-		} while (Q != identity);
-		return count;
+		for (size_t length = N; length > 0; length--) {
+			for (size_t k = 0; k < histogram[length]; k++) {
+				lengths[count++] = length;
+			}
+		}
+		return lengths;
 	}
-	size_t inversionCount() const {
+	size_t cycleLength() const {
 		base_type const &P = *this;
-		size_t count = 0;
+		std::array<bool, N> visited = { };
+		size_t order = 1;
 		for (size_t n = 0; n < N; n++) {
-			for (size_t m = n + 1; m < N; m++) {
-				if (P[n] > P[m]) {
-					count++;
+			if (!visited[n]) {
+				size_t length = 0;
+				for (size_t m = n; !visited[m]; m = P[m] - 1) {
+					visited[m] = true;
+					length++;
 				}
+				order = std::lcm(order, length);
+			}
+		}
+		return order;
+	}
+	size_t inversionCount() const {
+		base_type const &P = *this;
+		std::array<size_t, N + 1> tree = { };
+		size_t count = 0;
+		for (size_t n = N; n > 0; n--) {
+			for (size_t i = P[n - 1] - 1; i > 0; i -= i & -i) {
+				count += tree[i];
+			}
+			for (size_t i = P[n - 1]; i <= N; i += i & -i) {
+				tree[i]++;
 			}
 		}
 		return count;
@@ -121,6 +163,320 @@ struct Permutation: public std::array<size_t, N> {
 };
 
 
+/*
+ * Permutation of up to 16 points packed as one 0-based byte per lane in a 128-bit word, lanes N..15 fixed, next to
+ * the lanes of its inverse. Products read left to right like PermutationGroup::compose, (A then B)[n] = B[A[n]], and
+ * every operation that Permutation does with a scatter is a gather by the inverse here, so composition, products,
+ * inversion and byte application are each one or two pshufb.
+ */
+template<size_t N>
+struct PackedPermutation {
+	static_assert(N <= 16, "PackedPermutation holds at most 16 points.");
+	using lanes_type = std::array<uint8_t, 16>;
+	alignas(16) lanes_type lanes;
+	alignas(16) lanes_type inverseLanes;
+	static constexpr PackedPermutation identity() {
+		PackedPermutation p;
+		std::iota(p.lanes.begin(), p.lanes.end(), uint8_t(0));
+		p.inverseLanes = p.lanes;
+		return p;
+	}
+	constexpr PackedPermutation() = default;
+	constexpr PackedPermutation(Permutation<N> const &P) :
+			PackedPermutation(identity()) {
+		for (size_t n = 0; n < N; n++) {
+			lanes[n] = uint8_t(P[n] - 1);
+			inverseLanes[P[n] - 1] = uint8_t(n);
+		}
+	}
+	constexpr Permutation<N> unpack() const {
+		Permutation<N> P;
+		for (size_t n = 0; n < N; n++) {
+			P[n] = size_t(lanes[n]) + 1;
+		}
+		return P;
+	}
+	/* result[n] = values[indices[n]] */
+	static lanes_type gather(lanes_type const &values, lanes_type const &indices) {
+		lanes_type result;
+#ifdef __SSSE3__
+		__m128i const v = _mm_load_si128(reinterpret_cast<__m128i const*>(values.data()));
+		__m128i const i = _mm_load_si128(reinterpret_cast<__m128i const*>(indices.data()));
+		_mm_store_si128(reinterpret_cast<__m128i*>(result.data()), _mm_shuffle_epi8(v, i));
+#else
+		for (size_t n = 0; n < 16; n++) {
+			result[n] = values[indices[n]];
+		}
+#endif
+		return result;
+	}
+	/* (A then B)^-1 = B^-1 then A^-1 */
+	static PackedPermutation compose(PackedPermutation const &A, PackedPermutation const &B) {
+		PackedPermutation C;
+		C.lanes = gather(B.lanes, A.lanes);
+		C.inverseLanes = gather(A.inverseLanes, B.inverseLanes);
+		return C;
+	}
+	PackedPermutation inverse() const {
+		PackedPermutation I;
+		I.lanes = inverseLanes;
+		I.inverseLanes = lanes;
+		return I;
+	}
+	/* Same convention as Permutation::operator*, A[P[n]] = B[n], which is P^-1 then B. */
+	PackedPermutation operator*(PackedPermutation const &B) const {
+		return compose(inverse(), B);
+	}
+	/* Same convention as Permutation::apply, A[P[n]] = B[n], read as A[n] = B[P^-1[n]]. */
+	template<RandomAccess Container>
+	Container apply(Container const &B) const {
+		Container A;
+		for (size_t n = 0; n < N; n++) {
+			A[n] = B[inverseLanes[n]];
+		}
+		return A;
+	}
+	lanes_type apply(lanes_type const &B) const {
+		return gather(B, inverseLanes);
+	}
+	bool operator==(PackedPermutation const &other) const {
+		return lanes == other.lanes;
+	}
+	/* Cycle lengths in descending order, zero padded, from one pass and a counting sort over the lengths. */
+	std::array<size_t, N> cycleType() const {
+		std::array<size_t, N + 1> histogram = { };
+		uint32_t visited = 0;
+		for (size_t n = 0; n < N; n++) {
+			if (!(visited & (uint32_t(1) << n))) {
+				size_t length = 0;
+				for (size_t m = n; !(visited & (uint32_t(1) << m)); m = lanes[m]) {
+					visited |= uint32_t(1) << m;
+					length++;
+				}
+				histogram[length]++;
+			}
+		}
+		std::array<size_t, N> lengths = { };
+		size_t count = 0;
+		for (size_t length = N; length > 0; length--) {
+			for (size_t k = 0; k < histogram[length]; k++) {
+				lengths[count++] = length;
+			}
+		}
+		return lengths;
+	}
+	size_t order() const {
+		uint32_t visited = 0;
+		size_t order = 1;
+		for (size_t n = 0; n < N; n++) {
+			if (!(visited & (uint32_t(1) << n))) {
+				size_t length = 0;
+				for (size_t m = n; !(visited & (uint32_t(1) << m)); m = lanes[m]) {
+					visited |= uint32_t(1) << m;
+					length++;
+				}
+				order = std::lcm(order, length);
+			}
+		}
+		return order;
+	}
+	/* For each lane, counts the larger values already seen to its left with a popcount over a 16-bit mask. */
+	size_t inversionCount() const {
+		uint32_t seen = 0;
+		size_t count = 0;
+		for (size_t n = 0; n < N; n++) {
+			count += std::popcount(seen >> lanes[n]);
+			seen |= uint32_t(1) << lanes[n];
+		}
+		return count;
+	}
+	int parity() const {
+		return (inversionCount() & 1) ? -1 : +1;
+	}
+	std::vector<PackedPermutation> generateSubgroup() const {
+		std::vector<PackedPermutation> G;
+		PackedPermutation Q = identity();
+		do {
+			G.emplace_back(Q);
+			Q = compose(Q, *this);
+		} while (!(Q == identity()));
+		return G;
+	}
+};
 
+/*
+ * Permutation group given by generators, stored as a base and strong generating set (Schreier-Sims).
+ *
+ * Level l holds the base point b_l, the generators of the pointwise stabilizer of b_0..b_{l-1}, and a transversal
+ * mapping each point x of the orbit of b_l to an element taking b_l to x. A permutation acts on the 1-based point
+ * x as x -> P[x - 1], and products read left to right: (A then B)(x) = B(A(x)). Up to 16 points the chain is kept
+ * as PackedPermutation, so the products and inverses in sift and extend are shuffles.
+ */
+template<size_t N>
+struct PermutationGroup {
+	PermutationGroup() = default;
+	PermutationGroup(std::vector<Permutation<N>> const &generators) {
+		for (auto const &g : generators) {
+			extend(0, element_type(g));
+		}
+	}
+	static PermutationGroup symmetric() {
+		std::vector<Permutation<N>> generators;
+		if constexpr (N > 1) {
+			Permutation<N> transposition = Permutation<N>::identity;
+			Permutation<N> cycle;
+			std::swap(transposition[0], transposition[1]);
+			for (size_t n = 0; n < N; n++) {
+				cycle[n] = (n + 1) % N + 1;
+			}
+			generators = { transposition, cycle };
+		}
+		return PermutationGroup(generators);
+	}
+	static Permutation<N> compose(Permutation<N> const &A, Permutation<N> const &B) {
+		Permutation<N> C;
+		for (size_t n = 0; n < N; n++) {
+			C[n] = B[A[n] - 1];
+		}
+		return C;
+	}
+	size_t order() const {
+		size_t count = 1;
+		for (auto const &level : levels) {
+			if (__builtin_mul_overflow(count, level.orbit.size(), &count)) {
+				throw std::overflow_error("PermutationGroup order does not fit in size_t.\n");
+			}
+		}
+		return count;
+	}
+	bool contains(Permutation<N> const &g) const {
+		return sift(element_type(g), 0).first == identity();
+	}
+	template<typename Generator>
+	Permutation<N> random(Generator &generator) const {
+		element_type g = identity();
+		/* Same factorization as sift, u_k then ... then u_0, so every element has exactly one product. */
+		for (auto const &level : levels) {
+			std::uniform_int_distribution<size_t> distribution(0, level.orbit.size() - 1);
+			g = product(level.transversal[level.orbit[distribution(generator)] - 1], g);
+		}
+		return unpack(g);
+	}
+	std::vector<size_t> base() const {
+		std::vector<size_t> points;
+		for (auto const &level : levels) {
+			points.push_back(level.point);
+		}
+		return points;
+	}
+	std::vector<Permutation<N>> strongGenerators() const {
+		std::vector<Permutation<N>> generators;
+		for (auto const &level : levels) {
+			for (auto const &g : level.generators) {
+				if (std::find(generators.begin(), generators.end(), unpack(g)) == generators.end()) {
+					generators.push_back(unpack(g));
+				}
+			}
+		}
+		return generators;
+	}
+private:
+	static constexpr bool packed = (N <= 16);
+	using element_type = std::conditional_t<packed, PackedPermutation<N>, Permutation<N>>;
+	static element_type identity() {
+		if constexpr (packed) {
+			return element_type::identity();
+		} else {
+			return Permutation<N>::identity;
+		}
+	}
+	static element_type product(element_type const &A, element_type const &B) {
+		if constexpr (packed) {
+			return element_type::compose(A, B);
+		} else {
+			return compose(A, B);
+		}
+	}
+	static size_t image(element_type const &g, size_t x) {
+		if constexpr (packed) {
+			return size_t(g.lanes[x - 1]) + 1;
+		} else {
+			return g[x - 1];
+		}
+	}
+	static Permutation<N> unpack(element_type const &g) {
+		if constexpr (packed) {
+			return g.unpack();
+		} else {
+			return g;
+		}
+	}
+	struct Level {
+		size_t point;
+		std::vector<element_type> generators;
+		std::vector<size_t> orbit;
+		std::array<element_type, N> transversal;
+		std::array<bool, N> inOrbit;
+	};
+	/* Strips g through the levels from l onward; returns the residue and the level at which it stopped. */
+	std::pair<element_type, size_t> sift(element_type g, size_t l) const {
+		for (; l < levels.size(); l++) {
+			Level const &level = levels[l];
+			size_t const x = image(g, level.point);
+			if (!level.inOrbit[x - 1]) {
+				break;
+			}
+			g = product(g, level.transversal[x - 1].inverse());
+		}
+		return {g, l};
+	}
+	void extend(size_t l, element_type const &g) {
+		if (sift(g, l).first == identity()) {
+			return;
+		}
+		if (l == levels.size()) {
+			Level level;
+			size_t point = 1;
+			while (image(g, point) == point) {
+				point++;
+			}
+			level.point = point;
+			level.orbit.push_back(point);
+			level.inOrbit.fill(false);
+			level.inOrbit[point - 1] = true;
+			level.transversal[point - 1] = identity();
+			levels.push_back(std::move(level));
+		}
+		levels[l].generators.push_back(g);
+		size_t const oldCount = levels[l].orbit.size();
+		/* Grow the orbit: old points only need the new generator, new points need all of them. */
+		for (size_t i = 0; i < levels[l].orbit.size(); i++) {
+			Level &level = levels[l];
+			size_t const y = level.orbit[i];
+			size_t const first = (i < oldCount) ? level.generators.size() - 1 : 0;
+			for (size_t s = first; s < level.generators.size(); s++) {
+				size_t const x = image(level.generators[s], y);
+				if (!level.inOrbit[x - 1]) {
+					level.inOrbit[x - 1] = true;
+					level.transversal[x - 1] = product(level.transversal[y - 1], level.generators[s]);
+					level.orbit.push_back(x);
+				}
+			}
+		}
+		/* Schreier generators u_y s u_{s(y)}^-1 not already covered by the stabilizer chain below. */
+		for (size_t i = 0; i < levels[l].orbit.size(); i++) {
+			size_t const generatorCount = levels[l].generators.size();
+			size_t const first = (i < oldCount) ? generatorCount - 1 : 0;
+			for (size_t s = first; s < generatorCount; s++) {
+				Level const &level = levels[l];
+				size_t const y = level.orbit[i];
+				element_type const S = level.generators[s];
+				element_type const h = product(product(level.transversal[y - 1], S), level.transversal[image(S, y) - 1].inverse());
+				extend(l + 1, h);
+			}
+		}
+	}
+	std::vector<Level> levels;
+};
 
 #endif /* INCLUDE_PERMUTATION_HPP_ */
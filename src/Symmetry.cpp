@@ -2,12 +2,18 @@
 #include "Permutation.hpp"
 #include <algorithm>
 #include <array>
-#include <bitset>
 #include <concepts>
 #include <cstddef>
+#include <cstdint>
 #include <cmath>
+#include <limits>
+#include <map>
 #include <numeric>
+#include <random>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <functional>
@@ -28,7 +34,7 @@ struct IntegerPartition: public std::array<size_t, N> {
 		std::plus<size_t> const op { };
 		return std::accumulate(this->begin(), this->end, 0, op) == N;
 	}
-	size_t size() const {
+	constexpr size_t size() const {
 		size_t n = 0;
 		size_t i = 0;
 		while (n < N) {
@@ -36,7 +42,7 @@ struct IntegerPartition: public std::array<size_t, N> {
 		}
 		return i;
 	}
-	bool operator<(IntegerPartition const &other) const {
+	constexpr bool operator<(IntegerPartition const &other) const {
 		size_t const a = size();
 		size_t const b = other.size();
 		if (a < b) {
@@ -53,7 +59,7 @@ struct IntegerPartition: public std::array<size_t, N> {
 		}
 		return false;
 	}
-	IntegerPartition conjugate() const {
+	constexpr IntegerPartition conjugate() const {
 		IntegerPartition conj = { 0 };
 		for (size_t n = 0; n < N; n++) {
 			for (size_t m = 0; m < (*this)[n]; m++) {
@@ -64,6 +70,263 @@ struct IntegerPartition: public std::array<size_t, N> {
 	}
 };
 
+template<size_t N>
+constexpr size_t partitionCount() {
+	std::array<size_t, N + 1> count = { 1 };
+	for (size_t part = 1; part <= N; part++) {
+		for (size_t n = part; n <= N; n++) {
+			count[n] += count[n - part];
+		}
+	}
+	return count[N];
+}
+
+/*
+ * Zoghbi-Stojmenovic ZS1: visits the partitions of N in reverse lexicographic order, N first and 1 + ... + 1 last,
+ * in O(1) amortized time per partition and without allocating.
+ */
+template<size_t N>
+struct PartitionGenerator {
+	constexpr PartitionGenerator() {
+		x.fill(1);
+		x[1] = N;
+		m = 1;
+		h = 1;
+	}
+	constexpr size_t parts() const {
+		return m;
+	}
+	constexpr IntegerPartition<N> current() const {
+		IntegerPartition<N> partition = { 0 };
+		for (size_t i = 1; i <= m; i++) {
+			partition[i - 1] = x[i];
+		}
+		return partition;
+	}
+	constexpr bool next() {
+		if (x[1] == 1) {
+			return false;
+		}
+		if (x[h] == 2) {
+			m++;
+			x[h] = 1;
+			h--;
+		} else {
+			size_t const r = x[h] - 1;
+			size_t t = m - h + 1;
+			x[h] = r;
+			while (t >= r) {
+				h++;
+				x[h] = r;
+				t -= r;
+			}
+			if (t == 0) {
+				m = h;
+			} else {
+				m = h + 1;
+				if (t > 1) {
+					h++;
+					x[h] = t;
+				}
+			}
+		}
+		return true;
+	}
+private:
+	std::array<size_t, N + 1> x;
+	size_t m;
+	size_t h;
+};
+
+/* offsets[k] is the number of partitions of N with fewer than k parts, from p(n, k) = p(n - 1, k - 1) + p(n - k, k). */
+template<size_t N>
+constexpr std::array<size_t, N + 2> partitionOffsets() {
+	std::array<std::array<size_t, N + 1>, N + 1> count = { };
+	count[0][0] = 1;
+	for (size_t n = 1; n <= N; n++) {
+		for (size_t k = 1; k <= n; k++) {
+			count[n][k] = count[n - 1][k - 1] + count[n - k][k];
+		}
+	}
+	std::array<size_t, N + 2> offsets = { };
+	for (size_t k = 1; k <= N; k++) {
+		offsets[k + 1] = offsets[k] + count[N][k];
+	}
+	return offsets;
+}
+
+/*
+ * Applies f to every partition of N and stores the results in IntegerPartition::operator< order, which is the
+ * generation order stably bucketed by the number of parts.
+ */
+template<size_t N, typename F>
+constexpr auto partitionTable(F const &f) {
+	std::array<decltype(f(std::declval<IntegerPartition<N>>())), partitionCount<N>()> table;
+	auto offsets = partitionOffsets<N>();
+	PartitionGenerator<N> generator;
+	do {
+		table[offsets[generator.parts()]++] = f(generator.current());
+	} while (generator.next());
+	return table;
+}
+
+/* Run-time counterpart of partitionTable for N too large to tabulate at compile time. */
+template<size_t N, typename F>
+auto partitionVector(F const &f) {
+	std::vector<decltype(f(std::declval<IntegerPartition<N>>()))> table(partitionCount<N>());
+	auto offsets = partitionOffsets<N>();
+	PartitionGenerator<N> generator;
+	do {
+		table[offsets[generator.parts()]++] = f(generator.current());
+	} while (generator.next());
+	return table;
+}
+
+/* Calls f(row, col, hook) for every cell of the Young diagram of lambda, row by row. */
+template<size_t N, typename F>
+constexpr void forEachHook(IntegerPartition<N> const &lambda, F &&f) {
+	size_t rows = 0;
+	while (rows < N && lambda[rows]) {
+		rows++;
+	}
+	for (size_t row = 0; row < rows; row++) {
+		size_t height = rows;
+		for (size_t col = 0; col < lambda[row]; col++) {
+			while (lambda[height - 1] <= col) {
+				height--;
+			}
+			f(row, col, lambda[row] - col + height - row - 1);
+		}
+	}
+}
+
+__extension__ typedef unsigned __int128 hook_integer;
+
+constexpr hook_integer gcd128(hook_integer a, hook_integer b) {
+	while (b) {
+		hook_integer const t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*
+ * Product of the numerator factors over the product of the hook lengths. Both products are kept in 128 bits and only
+ * reduced by their gcd when they come close to overflowing, which never happens for dimIrrRepSn below N = 34.
+ */
+template<size_t N>
+constexpr size_t hookQuotient(IntegerPartition<N> const &lambda, std::array<size_t, N> const &numerators) {
+	hook_integer numerator = 1;
+	hook_integer denominator = 1;
+	size_t n = 0;
+	forEachHook(lambda, [&](size_t, size_t, size_t hook) {
+		size_t const factor = numerators[n++];
+		if (numerator > ~hook_integer(0) / factor || denominator > ~hook_integer(0) / hook) {
+			hook_integer const g = gcd128(numerator, denominator);
+			numerator /= g;
+			denominator /= g;
+			if (numerator > ~hook_integer(0) / factor || denominator > ~hook_integer(0) / hook) {
+				throw std::overflow_error("Hook quotient overflows 128 bits, use IrrepDimensions.\n");
+			}
+		}
+		numerator *= factor;
+		denominator *= hook;
+	});
+	if (numerator / denominator > std::numeric_limits<size_t>::max()) {
+		throw std::overflow_error("Irrep dimension does not fit in size_t, use IrrepDimensions.\n");
+	}
+	return size_t(numerator / denominator);
+}
+
+template<size_t N>
+constexpr size_t dimIrrRepSn(IntegerPartition<N> const &lambda) {
+	std::array<size_t, N> numerators;
+	std::iota(numerators.begin(), numerators.end(), size_t(1));
+	return hookQuotient(lambda, numerators);
+}
+
+template<size_t N>
+constexpr size_t dimIrrRepGL(IntegerPartition<N> const &lambda, size_t dim) {
+	std::array<size_t, N> numerators = { };
+	size_t n = 0;
+	for (size_t row = 0; row < N && lambda[row]; row++) {
+		for (size_t col = 0; col < lambda[row]; col++) {
+			if (dim + col <= row) {
+				return 0;
+			}
+			numerators[n++] = dim + col - row;
+		}
+	}
+	return hookQuotient(lambda, numerators);
+}
+
+template<size_t N>
+inline constexpr auto integerPartitionTable = partitionTable<N>([](IntegerPartition<N> const &lambda) {
+	return lambda;
+});
+
+template<size_t N>
+inline constexpr auto dimIrrRepSnTable = partitionTable<N>([](IntegerPartition<N> const &lambda) {
+	return dimIrrRepSn(lambda);
+});
+
+template<size_t N, size_t D>
+inline constexpr auto dimIrrRepGLTable = partitionTable<N>([](IntegerPartition<N> const &lambda) {
+	return dimIrrRepGL(lambda, D);
+});
+
+/*
+ * Exact irrep dimensions of any size. Each dimension is a vector of prime exponents, numerator factors added and hook
+ * lengths subtracted, multiplied out at the end. Factorizations of 1..N + maxDim come from one shared table, so the
+ * batch functions cost a few exponent updates per cell.
+ */
+template<size_t N>
+struct IrrepDimensions {
+	IrrepDimensions(size_t maxDim = 0) :
+			primes(std::max(N, maxDim + N)) {
+		factorialExponents.assign(primes.primeCount(), 0);
+		for (size_t n = 2; n <= N; n++) {
+			primes.accumulate(factorialExponents, n, +1);
+		}
+	}
+	BigUnsigned dimSn(IntegerPartition<N> const &lambda) const {
+		std::vector<int> exponents = factorialExponents;
+		forEachHook(lambda, [&](size_t, size_t, size_t hook) {
+			primes.accumulate(exponents, hook, -1);
+		});
+		return primes.evaluate(exponents);
+	}
+	BigUnsigned dimGL(IntegerPartition<N> const &lambda, size_t dim) const {
+		if (dim + N > primes.maxValue() + 1) {
+			throw std::invalid_argument("IrrepDimensions was built for a smaller dimension.\n");
+		}
+		std::vector<int> exponents(primes.primeCount(), 0);
+		bool vanishes = false;
+		forEachHook(lambda, [&](size_t row, size_t col, size_t hook) {
+			vanishes = vanishes || (dim + col <= row);
+			if (!vanishes) {
+				primes.accumulate(exponents, dim + col - row, +1);
+				primes.accumulate(exponents, hook, -1);
+			}
+		});
+		return vanishes ? BigUnsigned(0) : primes.evaluate(exponents);
+	}
+	std::vector<BigUnsigned> dimSnAll() const {
+		return partitionVector<N>([this](IntegerPartition<N> const &lambda) {
+			return dimSn(lambda);
+		});
+	}
+	std::vector<BigUnsigned> dimGLAll(size_t dim) const {
+		return partitionVector<N>([this, dim](IntegerPartition<N> const &lambda) {
+			return dimGL(lambda, dim);
+		});
+	}
+private:
+	PrimeFactorTable primes;
+	std::vector<int> factorialExponents;
+};
+
 template<size_t N>
 struct YoungTableau {
 	YoungTableau(IntegerPartition<N> const &P) {
@@ -155,32 +418,16 @@ struct YoungTableau {
 		return hLength;
 	}
 	size_t dimIrrRepSn() const {
-		size_t hookLengthProduct = 1;
-		size_t const nRow = lambda.size();
-		for (size_t row = 0; row < nRow; row++) {
-			size_t const nCol = lambda[row];
-			for (size_t col = 0; col < nCol; col++) {
-				hookLengthProduct *= hookLength(row, col);
-			}
-		}
-		return factorial(N) / hookLengthProduct;
+		return ::dimIrrRepSn(lambda);
 	}
 	size_t dimIrrRepGL(size_t dim) const {
-		size_t hookLengthProduct = 1;
-		size_t numerator = 1;
-		size_t const nRow = lambda.size();
-		for (size_t row = 0; row < nRow; row++) {
-			size_t const nCol = lambda[row];
-			for (size_t col = 0; col < nCol; col++) {
-				hookLengthProduct *= hookLength(row, col);
-				if (dim + col <= row) {
-					numerator = 0;
-					break;
-				}
-				numerator *= dim + col - row;
-			}
-		}
-		return numerator / hookLengthProduct;
+		return ::dimIrrRepGL(lambda, dim);
+	}
+	BigUnsigned dimIrrRepSnExact() const {
+		return IrrepDimensions<N>().dimSn(lambda);
+	}
+	BigUnsigned dimIrrRepGLExact(size_t dim) const {
+		return IrrepDimensions<N>(dim).dimGL(lambda, dim);
 	}
 private:
 	size_t flatIndex(size_t i, size_t j) const {
@@ -222,7 +469,7 @@ template<size_t D, size_t R>
 std::vector<std::vector<IndexTuple<D, R>>> generateTuples(Permutation<R> const &permutation) {
 	std::vector<std::vector<IndexTuple<D, R>>> subgroups;
 	using indices_type = IndexTuple<D, R>;
-	std::bitset<IndexTuple<D, R>::elementCount()> visited;
+	std::vector<bool> visited(IndexTuple<D, R>::elementCount());
 	for (indices_type iTuple = indices_type::begin(); iTuple != indices_type::end(); iTuple++) {
 		if (!visited[iTuple.flatIndex()]) {
 			subgroups.push_back(generateTupleClass(permutation, iTuple));
@@ -234,33 +481,104 @@ std::vector<std::vector<IndexTuple<D, R>>> generateTuples(Permutation<R> const &
 	return subgroups;
 }
 
-template<size_t N>
-std::vector<IntegerPartition<N>> generateIntegerPartitions() {
-	std::vector<IntegerPartition<N>> rc;
-	std::function<void(IntegerPartition<N>&, size_t, size_t)> genParts;
-	genParts = [&rc, &genParts](IntegerPartition<N> &tup, size_t sum, size_t digit) {
-		if (sum == N) {
-			auto tmp = tup;
-			rc.push_back(tmp);
-			return;
-		}
-		if (digit >= N) {
-			return;
-		}
-		if (sum < N) {
-			size_t end = (digit == 0) ? N : tup[digit - 1];
-			for (size_t n = 1; n <= end; n++) {
-				tup[digit] = n;
-				genParts(tup, sum + n, digit + 1);
+/* All orbits in one contiguous tuple array; orbit k is tuples[offsets[k]] .. tuples[offsets[k + 1] - 1]. */
+template<size_t D, size_t R>
+struct OrbitTable {
+	std::vector<IndexTuple<D, R>> tuples;
+	std::vector<size_t> offsets;
+	size_t size() const {
+		return offsets.size() - 1;
+	}
+	std::span<IndexTuple<D, R> const> operator[](size_t k) const {
+		return std::span<IndexTuple<D, R> const>(tuples.data() + offsets[k], offsets[k + 1] - offsets[k]);
+	}
+};
+
+template<size_t D, size_t R>
+OrbitTable<D, R> generateOrbitTable(Permutation<R> const &permutation) {
+	using indices_type = IndexTuple<D, R>;
+	OrbitTable<D, R> table;
+	std::vector<bool> visited(indices_type::elementCount());
+	table.tuples.reserve(indices_type::elementCount());
+	table.offsets.push_back(0);
+	for (indices_type iTuple = indices_type::begin(); iTuple != indices_type::end(); iTuple++) {
+		if (!visited[iTuple.flatIndex()]) {
+			indices_type jTuple = iTuple;
+			do {
+				visited[jTuple.flatIndex()] = true;
+				table.tuples.push_back(jTuple);
+				jTuple = permutation.apply(jTuple);
+			} while (jTuple != iTuple);
+			table.offsets.push_back(table.tuples.size());
+		}
+	}
+	return table;
+}
+
+/*
+ * Yields the same orbits as generateTuples, one at a time, without a visited set. A tuple starts an orbit when no
+ * other member of its orbit precedes it lexicographically, so the working memory is a single orbit.
+ */
+template<size_t D, size_t R>
+struct OrbitGenerator {
+	using indices_type = IndexTuple<D, R>;
+	struct Sentinel {
+	};
+	struct Iterator {
+		Iterator(Permutation<R> const &P) :
+				permutation(P), leader(indices_type::begin()) {
+			advance();
+		}
+		std::vector<indices_type> const& operator*() const {
+			return orbit;
+		}
+		Iterator& operator++() {
+			leader++;
+			advance();
+			return *this;
+		}
+		bool operator==(Sentinel) const {
+			return leader == indices_type::end();
+		}
+	private:
+		void advance() {
+			for (; leader != indices_type::end(); leader++) {
+				orbit.clear();
+				indices_type iTuple = leader;
+				bool isLeader = true;
+				do {
+					if (iTuple < leader) {
+						isLeader = false;
+						break;
+					}
+					orbit.push_back(iTuple);
+					iTuple = permutation.apply(iTuple);
+				} while (iTuple != leader);
+				if (isLeader) {
+					return;
+				}
 			}
-			tup[digit] = 0;
 		}
+		Permutation<R> permutation;
+		indices_type leader;
+		std::vector<indices_type> orbit;
 	};
-	IntegerPartition<N> ipart;
-	std::fill(ipart.begin(), ipart.end(), 1);
-	genParts(ipart, 0, 0);
-	std::sort(rc.begin(), rc.end());
-	return rc;
+	OrbitGenerator(Permutation<R> const &P) :
+			permutation(P) {
+	}
+	Iterator begin() const {
+		return Iterator(permutation);
+	}
+	Sentinel end() const {
+		return Sentinel { };
+	}
+private:
+	Permutation<R> permutation;
+};
+
+template<size_t N>
+std::vector<IntegerPartition<N>> generateIntegerPartitions() {
+	return std::vector<IntegerPartition<N>>(integerPartitionTable<N>.begin(), integerPartitionTable<N>.end());
 }
 
 template<size_t N>
@@ -275,7 +593,408 @@ std::vector<Permutation<N>> generateSymmetricGroup() {
 	return group;
 }
 
+/*
+ * Projects a dense rank-N tensor, stored in IndexTuple<D, N>::flatIndex order, onto the GL(D) irreducible selected by
+ * a partition. The projector is (f / N!) * sum over row permutations p and column permutations q of sgn(q) (p q),
+ * applied as one list of signed slot permutations so that symmetrization and antisymmetrization happen in a single
+ * pass. The packed form holds the projected components at the semistandard fillings of the tableau, which are
+ * exactly dimIrrRepGL(D) values and determine the component uniquely.
+ */
+template<size_t D, size_t N>
+struct YoungProjector {
+	using tuple_type = IndexTuple<D, N>;
+	YoungProjector(IntegerPartition<N> const &lambda) {
+		YoungTableau<N> const young(lambda);
+		std::array<size_t, N> rowOf;
+		std::array<size_t, N> columnOf;
+		std::vector<std::vector<size_t>> slots;
+		for (size_t row = 0; row < lambda.size(); row++) {
+			slots.emplace_back();
+			for (size_t col = 0; col < lambda[row]; col++) {
+				size_t const slot = young(row, col) - 1;
+				rowOf[slot] = row;
+				columnOf[slot] = col;
+				slots.back().push_back(slot);
+			}
+		}
+		std::vector<Permutation<N>> rowGroup;
+		std::vector<Permutation<N>> columnGroup;
+		Permutation<N> P = Permutation<N>::identity;
+		do {
+			bool preservesRows = true;
+			bool preservesColumns = true;
+			for (size_t n = 0; n < N; n++) {
+				preservesRows = preservesRows && (rowOf[P[n] - 1] == rowOf[n]);
+				preservesColumns = preservesColumns && (columnOf[P[n] - 1] == columnOf[n]);
+			}
+			if (preservesRows) {
+				rowGroup.push_back(P);
+			}
+			if (preservesColumns) {
+				columnGroup.push_back(P);
+			}
+			P = P.next();
+		} while (P != Permutation<N>::identity);
+		for (auto const &p : rowGroup) {
+			for (auto const &q : columnGroup) {
+				terms.emplace_back(PermutationGroup<N>::compose(q, p), q.parity());
+			}
+		}
+		scale = double(young.dimIrrRepSn()) / double(factorial(N));
+		packedIndex.assign(tuple_type::elementCount(), -1);
+		for (tuple_type indices = tuple_type::begin(); indices != tuple_type::end(); indices++) {
+			bool semistandard = true;
+			for (size_t row = 0; row < slots.size(); row++) {
+				for (size_t col = 0; col < slots[row].size(); col++) {
+					size_t const slot = slots[row][col];
+					if (col + 1 < slots[row].size()) {
+						semistandard = semistandard && (indices[slot] <= indices[slots[row][col + 1]]);
+					}
+					if (row + 1 < slots.size() && col < slots[row + 1].size()) {
+						semistandard = semistandard && (indices[slot] < indices[slots[row + 1][col]]);
+					}
+				}
+			}
+			if (semistandard) {
+				packedIndex[indices.flatIndex()] = positions.size();
+				positions.push_back(indices);
+			}
+		}
+		/* Components at the semistandard positions of the projected unit tensors, inverted for expand(). */
+		size_t const count = positions.size();
+		inverseBasis.assign(count * count, 0.0);
+		for (size_t i = 0; i < count; i++) {
+			for (auto const &[sigma, sign] : terms) {
+				ptrdiff_t const j = packedIndex[permute(positions[i], sigma).flatIndex()];
+				if (j >= 0) {
+					inverseBasis[i * count + j] += scale * sign;
+				}
+			}
+		}
+		invertMatrix(inverseBasis, count);
+	}
+	size_t size() const {
+		return positions.size();
+	}
+	template<typename T>
+	std::vector<T> project(std::vector<T> const &tensor) const {
+		std::vector<T> packed(positions.size());
+		for (size_t i = 0; i < positions.size(); i++) {
+			packed[i] = component(tensor, positions[i]);
+		}
+		return packed;
+	}
+	template<typename T>
+	std::vector<T> expand(std::vector<T> const &packed) const {
+		size_t const count = positions.size();
+		std::vector<T> sparse(tuple_type::elementCount(), T(0));
+		for (size_t i = 0; i < count; i++) {
+			T sum = T(0);
+			for (size_t j = 0; j < count; j++) {
+				sum += T(inverseBasis[i * count + j]) * packed[j];
+			}
+			sparse[positions[i].flatIndex()] = sum;
+		}
+		std::vector<T> tensor(tuple_type::elementCount());
+		for (tuple_type indices = tuple_type::begin(); indices != tuple_type::end(); indices++) {
+			tensor[indices.flatIndex()] = component(sparse, indices);
+		}
+		return tensor;
+	}
+private:
+	static tuple_type permute(tuple_type const &indices, Permutation<N> const &sigma) {
+		tuple_type result;
+		for (size_t n = 0; n < N; n++) {
+			result[n] = indices[sigma[n] - 1];
+		}
+		return result;
+	}
+	template<typename T>
+	T component(std::vector<T> const &tensor, tuple_type const &indices) const {
+		T sum = T(0);
+		for (auto const &[sigma, sign] : terms) {
+			T const value = tensor[permute(indices, sigma).flatIndex()];
+			sum += (sign > 0) ? value : -value;
+		}
+		return T(scale) * sum;
+	}
+	static void invertMatrix(std::vector<double> &A, size_t n) {
+		std::vector<double> I(n * n, 0.0);
+		for (size_t i = 0; i < n; i++) {
+			I[i * n + i] = 1.0;
+		}
+		for (size_t col = 0; col < n; col++) {
+			size_t pivot = col;
+			for (size_t row = col + 1; row < n; row++) {
+				if (std::abs(A[row * n + col]) > std::abs(A[pivot * n + col])) {
+					pivot = row;
+				}
+			}
+			if (A[pivot * n + col] == 0.0) {
+				throw std::runtime_error("Young projector basis is singular.\n");
+			}
+			for (size_t k = 0; k < n; k++) {
+				std::swap(A[pivot * n + k], A[col * n + k]);
+				std::swap(I[pivot * n + k], I[col * n + k]);
+			}
+			double const factor = 1.0 / A[col * n + col];
+			for (size_t k = 0; k < n; k++) {
+				A[col * n + k] *= factor;
+				I[col * n + k] *= factor;
+			}
+			for (size_t row = 0; row < n; row++) {
+				double const f = A[row * n + col];
+				if (row != col && f != 0.0) {
+					for (size_t k = 0; k < n; k++) {
+						A[row * n + k] -= f * A[col * n + k];
+						I[row * n + k] -= f * I[col * n + k];
+					}
+				}
+			}
+		}
+		A = std::move(I);
+	}
+	std::vector<std::pair<Permutation<N>, int>> terms;
+	std::vector<tuple_type> positions;
+	std::vector<ptrdiff_t> packedIndex;
+	std::vector<double> inverseBasis;
+	double scale;
+};
+
+static void check(bool condition, std::string const &what) {
+	if (!condition) {
+		throw std::runtime_error(what + " check failed.\n");
+	}
+}
+
+/* Brute-force closure under products, the reference for the Schreier-Sims order and membership. */
+template<size_t N>
+std::vector<Permutation<N>> closeGroup(std::vector<Permutation<N>> const &generators) {
+	std::vector<Permutation<N>> group(1, Permutation<N>::identity);
+	for (size_t n = 0; n < group.size(); n++) {
+		for (auto const &g : generators) {
+			Permutation<N> const product = PermutationGroup<N>::compose(group[n], g);
+			if (std::find(group.begin(), group.end(), product) == group.end()) {
+				group.push_back(product);
+			}
+		}
+	}
+	return group;
+}
+
+template<size_t N>
+void testPermutationGroup(std::vector<Permutation<N>> const &generators, std::string const &name) {
+	PermutationGroup<N> const group(generators);
+	auto const elements = closeGroup(generators);
+	check(group.order() == elements.size(), name + " order");
+	for (auto const &P : generateSymmetricGroup<N>()) {
+		bool const member = std::find(elements.begin(), elements.end(), P) != elements.end();
+		check(group.contains(P) == member, name + " contains");
+	}
+	/* Every element should come up about samplesPer times; the tolerance is over ten standard deviations. */
+	constexpr size_t samplesPer = 10000;
+	std::mt19937_64 generator(42);
+	std::map<Permutation<N>, size_t> histogram;
+	for (size_t n = 0; n < samplesPer * elements.size(); n++) {
+		Permutation<N> const P = group.random(generator);
+		check(group.contains(P), name + " random membership");
+		histogram[P]++;
+	}
+	check(histogram.size() == elements.size(), name + " random coverage");
+	for (auto const &[P, count] : histogram) {
+		check(10 * count > 9 * samplesPer && 10 * count < 11 * samplesPer, name + " random uniformity");
+	}
+}
+
+/* PackedPermutation against Permutation on every pair in the sample, including the conventions of *, apply and compose. */
+template<size_t N>
+void testPackedPermutation(std::vector<Permutation<N>> const &sample) {
+	using packed_type = PackedPermutation<N>;
+	std::array<size_t, N> values;
+	typename packed_type::lanes_type bytes = packed_type::identity().lanes;
+	for (size_t n = 0; n < N; n++) {
+		values[n] = 3 * n + 1;
+		bytes[n] = uint8_t(values[n]);
+	}
+	for (auto const &P : sample) {
+		packed_type const p(P);
+		check(p.unpack() == P, "PackedPermutation round trip");
+		check(p.inverse() == packed_type(P.inverse()), "PackedPermutation inverse");
+		check(p.apply(values) == P.apply(values), "PackedPermutation apply");
+		auto const shuffled = p.apply(bytes);
+		auto const expected = P.apply(values);
+		for (size_t n = 0; n < N; n++) {
+			check(shuffled[n] == expected[n], "PackedPermutation byte apply");
+		}
+		check(p.cycleType() == P.cycleType(), "PackedPermutation cycle type");
+		check(p.order() == P.cycleLength(), "PackedPermutation order");
+		check(p.parity() == P.parity(), "PackedPermutation parity");
+		for (auto const &Q : sample) {
+			packed_type const q(Q);
+			check(p * q == packed_type(P * Q), "PackedPermutation product");
+			check(packed_type::compose(p, q) == packed_type(PermutationGroup<N>::compose(P, Q)), "PackedPermutation compose");
+			check(packed_type::compose(p, q).inverse() == packed_type(PermutationGroup<N>::compose(P, Q).inverse()), "PackedPermutation composed inverse");
+		}
+	}
+}
+
+template<size_t N>
+std::vector<Permutation<N>> randomPermutations(size_t count) {
+	std::mt19937_64 generator(7);
+	std::vector<Permutation<N>> sample(count, Permutation<N>::identity);
+	for (auto &P : sample) {
+		std::shuffle(P.begin(), P.end(), generator);
+	}
+	return sample;
+}
+
+/* The CSR table and the lazy generator must list the same orbits, in the same order, as generateTuples. */
+template<size_t D, size_t R>
+void testOrbits(Permutation<R> const &permutation) {
+	auto const tuples = generateTuples<D, R>(permutation);
+	auto const table = generateOrbitTable<D, R>(permutation);
+	check(table.size() == tuples.size(), "OrbitTable size");
+	size_t k = 0;
+	for (auto const &orbit : OrbitGenerator<D, R>(permutation)) {
+		check(k < tuples.size() && orbit == tuples[k], "OrbitGenerator orbit");
+		check(std::equal(table[k].begin(), table[k].end(), tuples[k].begin(), tuples[k].end()), "OrbitTable orbit");
+		k++;
+	}
+	check(k == tuples.size(), "OrbitGenerator count");
+}
+
+/* Every partition of N exactly once, in IntegerPartition::operator< order, with p(N) entries. */
+template<size_t N>
+void testPartitions(size_t expectedCount) {
+	auto const identity = [](IntegerPartition<N> const &lambda) {
+		return lambda;
+	};
+	auto const table = partitionTable<N>(identity);
+	auto const vector = partitionVector<N>(identity);
+	check(partitionCount<N>() == expectedCount && table.size() == expectedCount, "Partition count");
+	check(std::equal(table.begin(), table.end(), vector.begin(), vector.end()), "partitionVector");
+	for (size_t k = 0; k < table.size(); k++) {
+		check(std::accumulate(table[k].begin(), table[k].end(), size_t(0)) == N, "Partition sum");
+		check(std::is_sorted(table[k].begin(), table[k].end(), std::greater<size_t>()), "Partition parts order");
+		check(k == 0 || table[k - 1] < table[k], "Partition table order");
+	}
+}
+
+static uint64_t residue(BigUnsigned const &value, uint64_t modulus) {
+	uint64_t r = 0;
+	for (size_t n = value.limbs.size(); n > 0; n--) {
+		r = uint64_t(((hook_integer(r) << 32) | value.limbs[n - 1]) % modulus);
+	}
+	return r;
+}
+
+/*
+ * Sum of f^2 over the partitions of N is N!, and sum of f dimGL(D) is D^N. Checked exactly on the 64-bit tables and
+ * modulo a prime on the exact dimensions, which also covers N whose dimensions no longer fit in 64 bits.
+ */
+template<size_t N, size_t D>
+void testIrrepDimensions() {
+	constexpr uint64_t modulus = 1000000007;
+	uint64_t factorialResidue = 1;
+	uint64_t powerResidue = 1;
+	for (size_t n = 1; n <= N; n++) {
+		factorialResidue = factorialResidue * n % modulus;
+		powerResidue = powerResidue * D % modulus;
+	}
+	IrrepDimensions<N> const dimensions(D);
+	auto const sn = dimensions.dimSnAll();
+	auto const gl = dimensions.dimGLAll(D);
+	uint64_t snSum = 0;
+	uint64_t glSum = 0;
+	for (size_t k = 0; k < sn.size(); k++) {
+		uint64_t const f = residue(sn[k], modulus);
+		snSum = (snSum + f * f) % modulus;
+		glSum = (glSum + f * residue(gl[k], modulus)) % modulus;
+	}
+	check(snSum == factorialResidue, "Sum of dimIrrRepSn squared");
+	check(glSum == powerResidue, "Sum of dimIrrRepSn times dimIrrRepGL");
+	if constexpr (N <= 20) {
+		hook_integer snExact = 0;
+		hook_integer glExact = 0;
+		hook_integer power = 1;
+		for (size_t k = 0; k < sn.size(); k++) {
+			size_t const f = dimIrrRepSnTable<N>[k];
+			check(sn[k] == BigUnsigned(f) && gl[k] == BigUnsigned(dimIrrRepGLTable<N, D>[k]), "IrrepDimensions");
+			snExact += hook_integer(f) * f;
+			glExact += hook_integer(f) * dimIrrRepGLTable<N, D>[k];
+		}
+		for (size_t n = 0; n < N; n++) {
+			power *= D;
+		}
+		check(snExact == factorial(N) && glExact == power, "Irrep dimension tables");
+	}
+}
+
+/*
+ * Every projector keeps exactly dimIrrRepGL(D) components, is idempotent up to rounding and, where that dimension is
+ * nonzero, keeps part of a generic tensor.
+ */
+template<size_t D, size_t N>
+void testYoungProjector() {
+	IrrepDimensions<N> const dimensions(D);
+	std::vector<double> tensor(IndexTuple<D, N>::elementCount());
+	for (size_t n = 0; n < tensor.size(); n++) {
+		tensor[n] = std::sin(double(n + 1));
+	}
+	for (auto const &part : generateIntegerPartitions<N>()) {
+		YoungProjector<D, N> const projector(part);
+		size_t const dimension = dimIrrRepGL(part, D);
+		check(projector.size() == dimension && BigUnsigned(dimension) == dimensions.dimGL(part, D), "YoungProjector size");
+		auto const component = projector.expand(projector.project(tensor));
+		auto const twice = projector.expand(projector.project(component));
+		double error = 0.0;
+		double magnitude = 0.0;
+		for (size_t n = 0; n < tensor.size(); n++) {
+			error = std::max(error, std::abs(twice[n] - component[n]));
+			magnitude = std::max(magnitude, std::abs(component[n]));
+		}
+		check(error <= 1e-12 * std::max(1.0, magnitude), "YoungProjector idempotency");
+		check((magnitude > 0.0) == (dimension > 0), "YoungProjector image");
+	}
+}
+
 void testSymmetry() {
+	testIrrepDimensions<4, 4>();
+	testIrrepDimensions<8, 3>();
+	testIrrepDimensions<12, 5>();
+	testIrrepDimensions<20, 3>();
+	testIrrepDimensions<40, 7>();
+	testPartitions<1>(1);
+	testPartitions<4>(5);
+	testPartitions<7>(15);
+	testPartitions<10>(42);
+	testPartitions<16>(231);
+	testOrbits<3, 4>( { 2, 3, 4, 1 });
+	testOrbits<3, 4>( { 2, 1, 4, 3 });
+	testOrbits<2, 5>( { 3, 1, 2, 5, 4 });
+	testOrbits<4, 3>(Permutation<3>::identity);
+	testPackedPermutation<5>(generateSymmetricGroup<5>());
+	testPackedPermutation<16>(randomPermutations<16>(64));
+	check(PermutationGroup<5>::symmetric().order() == 120, "S5 order");
+	check(PermutationGroup<9>::symmetric().order() == 362880, "S9 order");
+	check(PermutationGroup<17>::symmetric().order() == factorial(17), "S17 order");
+	check(PermutationGroup<20>::symmetric().order() == factorial(20), "S20 order");
+	bool overflowed = false;
+	try {
+		PermutationGroup<21>::symmetric().order();
+	} catch (std::overflow_error const&) {
+		overflowed = true;
+	}
+	check(overflowed, "S21 order overflow");
+	Permutation<24> cycle;
+	for (size_t n = 0; n < 24; n++) {
+		cycle[n] = (n + 1) % 24 + 1;
+	}
+	check(PermutationGroup<24>( { cycle }).order() == 24, "C24 order");
+	testPermutationGroup<4>( { { 2, 1, 3, 4 }, { 1, 2, 4, 3 }, { 3, 4, 1, 2 } }, "Dihedral group of order 8");
+	testPermutationGroup<5>( { { 2, 3, 4, 5, 1 }, { 1, 5, 4, 3, 2 } }, "Dihedral group of order 10");
+	testPermutationGroup<4>( { { 2, 1, 3, 4 }, { 2, 3, 4, 1 } }, "S4");
+	testPermutationGroup<5>( { { 2, 3, 1, 4, 5 }, { 1, 2, 4, 5, 3 }, { 1, 3, 4, 2, 5 } }, "A5");
 	constexpr size_t D = 4;
 	constexpr size_t R = 4;
 	auto parts = generateIntegerPartitions<R>();
@@ -284,4 +1003,7 @@ void testSymmetry() {
 		std::cout << young.toString() << "dimIrrRepSn = " << std::to_string(young.dimIrrRepSn()) << "\n";
 		std::cout << "dimIrrRepGL = " << std::to_string(young.dimIrrRepGL(D)) << "\n";
 	}
+	testYoungProjector<4, 4>();
+	testYoungProjector<3, 3>();
+	testYoungProjector<2, 4>();
 }
@@ -0,0 +1,363 @@
+/*
+ * Micro-benchmarks of the generated Tensor.hpp against hand-written dense loops.
+ *
+ * Every kernel is timed for D = 2..16, ranks 1..5 and no, full and full anti-symmetry. Times and bytes are
+ * normalized by the D^R logical elements, so packed storage shows up as fewer bytes per element. The dense inputs are
+ * read from the tensors, and each kernel is checked once against its dense counterpart before it is timed.
+ *
+ *    benchmark [access|assign|contract]
+ */
+#include "Tensor.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace Tensors;
+
+using real_type = double;
+
+static constexpr double minimumSeconds = 0.02;
+
+enum class SymmetryKind {
+	none, symmetric, antisymmetric
+};
+
+static char const *const symmetryNames[] = { "none", "sym", "antisym" };
+
+template<typename T>
+static inline void doNotOptimize(T const &value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+template<typename F>
+double secondsPerCall(F &&f) {
+	using clock = std::chrono::steady_clock;
+	size_t count = 1;
+	while (true) {
+		auto const start = clock::now();
+		for (size_t n = 0; n < count; n++) {
+			f();
+		}
+		double const seconds = std::chrono::duration<double>(clock::now() - start).count();
+		if (seconds >= minimumSeconds) {
+			return seconds / double(count);
+		}
+		count *= 2;
+	}
+}
+
+constexpr size_t power(size_t D, size_t R) {
+	size_t n = 1;
+	for (size_t r = 0; r < R; r++) {
+		n *= D;
+	}
+	return n;
+}
+
+/* Generators of the full (anti)symmetric group on R slots: the R - 1 adjacent transpositions. */
+template<size_t R, SymmetryKind K>
+constexpr auto symmetryGenerators() {
+	constexpr size_t count = (K == SymmetryKind::none || R < 2) ? 0 : (R - 1) * (R + 1);
+	std::array<int, count> list = { };
+	if constexpr (count > 0) {
+		for (size_t g = 0; g + 1 < R; g++) {
+			int *const entry = list.data() + g * (R + 1);
+			entry[0] = (K == SymmetryKind::symmetric) ? +1 : -1;
+			for (size_t r = 0; r < R; r++) {
+				entry[r + 1] = int(r);
+			}
+			std::swap(entry[g + 1], entry[g + 2]);
+		}
+	}
+	return list;
+}
+
+template<size_t D, size_t R, SymmetryKind K, typename = std::make_index_sequence<symmetryGenerators<R, K>().size()>>
+struct BenchTensor;
+
+template<size_t D, size_t R, SymmetryKind K, size_t ...N>
+struct BenchTensor<D, R, K, std::index_sequence<N...>> {
+	using type = Tensor<real_type, D, R, symmetryGenerators<R, K>()[N]...>;
+};
+
+template<size_t D, size_t R, SymmetryKind K>
+using bench_tensor_type = typename BenchTensor<D, R, K>::type;
+
+struct Result {
+	double tensorSeconds;
+	double denseSeconds;
+	double flops;
+	double bytes;
+};
+
+void report(char const *name, size_t D, size_t R, SymmetryKind K, size_t elements, Result const &result) {
+	double const tensorNs = 1e9 * result.tensorSeconds / double(elements);
+	double const denseNs = 1e9 * result.denseSeconds / double(elements);
+	char gflops[32] = "-";
+	if (result.flops > 0.0) {
+		std::snprintf(gflops, sizeof(gflops), "%.3f", 1e-9 * result.flops / result.tensorSeconds);
+	}
+	std::printf("%-10s %3zu %4zu %-8s %12.3f %12.3f %8.2f %10s %10.3f %10.3f\n", name, D, R, symmetryNames[int(K)], tensorNs, denseNs,
+			result.denseSeconds / result.tensorSeconds, gflops, 1e-9 * result.bytes / result.tensorSeconds, result.bytes / double(elements));
+}
+
+template<size_t R, typename F>
+inline void forEachTuple(size_t D, F &&f) {
+	std::array<size_t, R> indices = { };
+	while (true) {
+		f(indices);
+		size_t r = R;
+		while (r > 0 && ++indices[r - 1] == D) {
+			indices[--r] = 0;
+		}
+		if (r == 0) {
+			return;
+		}
+	}
+}
+
+template<size_t R>
+inline size_t denseIndex(size_t D, std::array<size_t, R> const &indices) {
+	size_t index = 0;
+	for (size_t r = 0; r < R; r++) {
+		index = D * index + indices[r];
+	}
+	return index;
+}
+
+template<typename T, size_t R, size_t ...N>
+inline decltype(auto) at(T &tensor, std::array<size_t, R> const &indices, std::index_sequence<N...>) {
+	return tensor(indices[N]...);
+}
+
+template<typename T, size_t ...N>
+inline auto labels(T &tensor, std::index_sequence<N...>) {
+	return tensor(Index<char('a' + N)> { }...);
+}
+
+template<typename T, size_t ...N>
+inline auto reversedLabels(T &tensor, std::index_sequence<N...>) {
+	return tensor(Index<char('a' + sizeof...(N) - 1 - N)> { }...);
+}
+
+/* Fills the packed storage and reads the dense copy back through the accessor, signs and zeros included. */
+template<size_t R, typename T>
+void fill(T &tensor, std::vector<real_type> &dense, size_t D) {
+	real_type *const data = tensor.data();
+	for (size_t n = 0; n < tensor.size(); n++) {
+		data[n] = real_type(n % 7) - real_type(3);
+	}
+	T const &source = tensor;
+	forEachTuple<R>(D, [&](std::array<size_t, R> const &indices) {
+		dense[denseIndex<R>(D, indices)] = at(source, indices, std::make_index_sequence<R>());
+	});
+}
+
+/* The values are small integers, so the tensor and dense kernels must agree exactly. */
+void verify(char const *name, bool agree) {
+	if (!agree) {
+		std::fprintf(stderr, "%s: the tensor and dense kernels disagree\n", name);
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+template<size_t R, typename T>
+void verify(char const *name, T const &tensor, std::vector<real_type> const &dense, size_t D) {
+	bool agree = true;
+	forEachTuple<R>(D, [&](std::array<size_t, R> const &indices) {
+		agree = agree && (at(tensor, indices, std::make_index_sequence<R>()) == dense[denseIndex<R>(D, indices)]);
+	});
+	verify(name, agree);
+}
+
+template<size_t D, size_t R, SymmetryKind K>
+void benchmarkAccess() {
+	using tensor_type = bench_tensor_type<D, R, K>;
+	constexpr size_t elements = power(D, R);
+	auto const tensor = std::make_unique<tensor_type>();
+	std::vector<real_type> dense(elements);
+	fill<R>(*tensor, dense, D);
+	tensor_type const &A = *tensor;
+	auto const tensorSum = [&]() {
+		real_type sum = real_type(0);
+		forEachTuple<R>(D, [&](std::array<size_t, R> const &indices) {
+			sum += at(A, indices, std::make_index_sequence<R>());
+		});
+		return sum;
+	};
+	auto const denseSum = [&]() {
+		real_type sum = real_type(0);
+		forEachTuple<R>(D, [&](std::array<size_t, R> const &indices) {
+			sum += dense[denseIndex<R>(D, indices)];
+		});
+		return sum;
+	};
+	verify("access", tensorSum() == denseSum());
+	Result result;
+	result.tensorSeconds = secondsPerCall([&]() {
+		doNotOptimize(tensorSum());
+	});
+	result.denseSeconds = secondsPerCall([&]() {
+		doNotOptimize(denseSum());
+	});
+	/* A load and an add per element: this kernel measures bandwidth, not arithmetic. */
+	result.flops = 0.0;
+	result.bytes = double(sizeof(real_type) * tensor_type::size());
+	report("access", D, R, K, elements, result);
+}
+
+template<size_t D, size_t R, SymmetryKind K>
+void benchmarkAssign() {
+	using tensor_type = bench_tensor_type<D, R, K>;
+	constexpr size_t elements = power(D, R);
+	auto const source = std::make_unique<tensor_type>();
+	auto const destination = std::make_unique<tensor_type>();
+	std::vector<real_type> denseSource(elements);
+	std::vector<real_type> denseDestination(elements);
+	fill<R>(*source, denseSource, D);
+	constexpr auto sequence = std::make_index_sequence<R>();
+	auto const tensorAssign = [&]() {
+		labels(*destination, sequence) = reversedLabels(std::as_const(*source), sequence);
+	};
+	auto const denseAssign = [&]() {
+		forEachTuple<R>(D, [&](std::array<size_t, R> const &indices) {
+			std::array<size_t, R> reversed;
+			for (size_t r = 0; r < R; r++) {
+				reversed[r] = indices[R - 1 - r];
+			}
+			denseDestination[denseIndex<R>(D, indices)] = denseSource[denseIndex<R>(D, reversed)];
+		});
+	};
+	tensorAssign();
+	denseAssign();
+	verify<R>("assign", *destination, denseDestination, D);
+	Result result;
+	result.tensorSeconds = secondsPerCall([&]() {
+		tensorAssign();
+		doNotOptimize(*destination);
+	});
+	result.denseSeconds = secondsPerCall([&]() {
+		denseAssign();
+		doNotOptimize(denseDestination);
+	});
+	result.flops = 0.0;
+	result.bytes = double(2 * sizeof(real_type) * tensor_type::size());
+	report("assign", D, R, K, elements, result);
+}
+
+/* C(a...) = A(a..., z) * v(z): contracts the last slot of A against a vector. */
+template<size_t D, size_t R, SymmetryKind K>
+void benchmarkContract() {
+	using tensor_type = bench_tensor_type<D, R, K>;
+	constexpr size_t elements = power(D, R);
+	auto const A = std::make_unique<tensor_type>();
+	auto const C = std::make_unique<Tensor<real_type, D, R - 1>>();
+	Tensor<real_type, D, 1> v;
+	std::vector<real_type> denseA(elements);
+	std::vector<real_type> denseC(elements / D);
+	std::vector<real_type> denseV(D);
+	fill<R>(*A, denseA, D);
+	for (size_t d = 0; d < D; d++) {
+		v(d) = denseV[d] = real_type(d + 1);
+	}
+	Index<'z'> z;
+	constexpr auto sequence = std::make_index_sequence<R - 1>();
+	real_type dot = real_type(0);
+	auto const tensorContract = [&]() {
+		auto const &a = std::as_const(*A);
+		auto const &w = std::as_const(v);
+		[&]<size_t ...N>(std::index_sequence<N...>) {
+			if constexpr (R == 1) {
+				dot = a(z) * w(z);
+			} else {
+				(*C)(Index<char('a' + N)> { }...) = a(Index<char('a' + N)> { }..., z) * w(z);
+			}
+		}(sequence);
+	};
+	auto const denseContract = [&]() {
+		for (size_t i = 0; i < elements / D; i++) {
+			real_type sum = real_type(0);
+			for (size_t d = 0; d < D; d++) {
+				sum += denseA[D * i + d] * denseV[d];
+			}
+			denseC[i] = sum;
+		}
+	};
+	tensorContract();
+	denseContract();
+	if constexpr (R == 1) {
+		verify("contract", dot == denseC[0]);
+	} else {
+		verify<R - 1>("contract", *C, denseC, D);
+	}
+	Result result;
+	result.tensorSeconds = secondsPerCall([&]() {
+		tensorContract();
+		doNotOptimize(dot);
+		doNotOptimize(*C);
+	});
+	result.denseSeconds = secondsPerCall([&]() {
+		denseContract();
+		doNotOptimize(denseC);
+	});
+	result.flops = double(2 * elements);
+	result.bytes = double(sizeof(real_type) * (tensor_type::size() + D + elements / D));
+	report("contract", D, R, K, elements, result);
+}
+
+template<size_t D, size_t R, SymmetryKind K>
+void benchmarkConfiguration(std::string const &filter) {
+	if constexpr (K == SymmetryKind::antisymmetric && R > D) {
+		return;
+	} else {
+		if (filter.empty() || filter == "access") {
+			benchmarkAccess<D, R, K>();
+		}
+		if (filter.empty() || filter == "assign") {
+			benchmarkAssign<D, R, K>();
+		}
+		if (filter.empty() || filter == "contract") {
+			benchmarkContract<D, R, K>();
+		}
+	}
+}
+
+template<size_t D, size_t R>
+void benchmarkRank(std::string const &filter) {
+	benchmarkConfiguration<D, R, SymmetryKind::none>(filter);
+	benchmarkConfiguration<D, R, SymmetryKind::symmetric>(filter);
+	benchmarkConfiguration<D, R, SymmetryKind::antisymmetric>(filter);
+}
+
+template<size_t D>
+void benchmarkDimension(std::string const &filter) {
+	benchmarkRank<D, 1>(filter);
+	benchmarkRank<D, 2>(filter);
+	benchmarkRank<D, 3>(filter);
+	benchmarkRank<D, 4>(filter);
+	benchmarkRank<D, 5>(filter);
+}
+
+template<size_t ...D>
+void benchmarkDimensions(std::string const &filter, std::index_sequence<D...>) {
+	(benchmarkDimension<D + 2>(filter), ...);
+}
+
+int main(int argc, char *argv[]) {
+	std::string const filter = (argc >= 2) ? argv[1] : "";
+	if (!filter.empty() && filter != "access" && filter != "assign" && filter != "contract") {
+		std::fprintf(stderr, "usage: benchmark [access|assign|contract]\n");
+		return -1;
+	}
+	std::printf("%-10s %3s %4s %-8s %12s %12s %8s %10s %10s %10s\n", "kernel", "D", "rank", "symmetry", "ns/elem", "dense ns/elem", "speedup", "GFLOP/s",
+			"GB/s", "bytes/elem");
+	benchmarkDimensions(filter, std::make_index_sequence<15>());
+	return 0;
+}
@@ -2,13 +2,15 @@
 
 #include <algorithm>
 #include <array>
-#include <cmath>
+#include <bit>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
-#include <limits>
 #include <numeric>
-#include <unordered_map>
 #include <set>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 static constexpr int ORDER = 5;
@@ -39,88 +41,6 @@ struct Symmetry {
 	}
 };
 
-template<size_t D, size_t R, size_t NS, size_t NA>
-auto genIndexMap(std::array<std::array<size_t, R>, NS> sym, std::array<std::array<size_t, R>, NA> ant) {
-	static constexpr size_t Size = std::pow(D, R);
-	std::array<size_t, Size> map;
-	std::array<int, Size> sgn;
-	std::array<bool, Size> visited = { false };
-	size_t s = Size;
-	std::array<size_t, R> indices = { 0 };
-	auto const I2i = [](std::array<size_t, R> indices) {
-		size_t i = 0;
-		for (size_t r = 0; r < R; r++) {
-			i = D * i + indices[r];
-		}
-		return i;
-	};
-	auto const permuteIndices = [](std::array<size_t, R> indices, std::array<size_t, R> permutation) {
-		std::array<size_t, R> result;
-		for (size_t r = 0; r < R; r++) {
-			result[r] = indices[permutation[r]];
-		}
-		return result;
-	};
-	size_t nextIndex = 0;
-	while (s--) {
-		size_t index = I2i(indices);
-		if (!visited[index]) {
-			static constexpr size_t symCount = 1 << (NS + NA);
-			std::array<int, symCount> signs = { 0 };
-			std::array<size_t, symCount> theseIndexes;
-			bool zero = false;
-			for (size_t bits = 0; bits < symCount; bits++) {
-				int sgn = +1;
-				size_t theseBits = bits;
-				auto theseIndices = indices;
-				for (size_t k = 0; k < NS; k++) {
-					if (theseBits & 1) {
-						theseIndices = permuteIndices(theseIndices, sym[k]);
-					}
-					theseBits >>= 1;
-				}
-				for (size_t k = 0; k < NA; k++) {
-					if (theseBits & 1) {
-						theseIndices = permuteIndices(theseIndices, ant[k]);
-						if (theseIndices == indices) {
-							sgn = 0;
-							zero = true;
-						} else {
-							sgn = -sgn;
-						}
-					}
-					theseBits >>= 1;
-				}
-				signs[bits] = sgn;
-				size_t const thisIndex = I2i(theseIndices);
-				theseIndexes[bits] = thisIndex;
-				visited[thisIndex] = true;
-			}
-			for (size_t bits = 0; bits < symCount; bits++) {
-				if (!zero) {
-					map[theseIndexes[bits]] = nextIndex;
-					sgn[theseIndexes[bits]] = signs[bits];
-				} else {
-					map[theseIndexes[bits]] = std::numeric_limits<size_t>::max();
-					sgn[theseIndexes[bits]] = 0;
-				}
-			}
-			if (!zero) {
-				nextIndex++;
-			}
-		}
-		if (s) {
-			std::reverse(indices.begin(), indices.end());
-			int r = 0;
-			while (++indices[r] == D) {
-				indices[r++] = 0;
-			}
-			std::reverse(indices.begin(), indices.end());
-		}
-	}
-	return std::make_pair(map, sgn);
-}
-
 void indexMapDeclaration(CodeGen &code) {
 	const char *codeString = "template<size_t, size_t R, auto...S>\n"
 			"static constexpr auto genIndexMap(Symmetries<R, S...> const&);\n";
@@ -131,14 +51,147 @@ void indexMapDeclaration(CodeGen &code) {
 }
 
 void indexMap2Header(CodeGen &code) {
-	const char *codeString = "template<size_t D, size_t R, auto...S>\n"
-			"static constexpr auto genIndexMap(Symmetries<R, S...> const& sym) {\n"
-			"    static constexpr size_t N = Symmetries<R, S...>::Size;\n"
-			"    static constexpr size_t Size = std::pow(D, R);\n"
-			"    std::array<size_t, Size> map;\n"
-			"    std::array<int, Size> sgn;\n"
+	const char *codeString =
+			"/* Lexicographic rank of a permutation from its Lehmer code. */\n"
+			"template<size_t R>\n"
+			"static constexpr size_t permutationRank(std::array<size_t, R> const& values) {\n"
+			"    size_t rank = 0;\n"
+			"    for (size_t r = 0; r < R; r++) {\n"
+			"        size_t smaller = 0;\n"
+			"        for (size_t s = r + 1; s < R; s++) {\n"
+			"            smaller += (values[s] < values[r]);\n"
+			"        }\n"
+			"        rank = rank * (R - r) + smaller;\n"
+			"    }\n"
+			"    return rank;\n"
+			"}\n"
+			"\n"
+			"/*\n"
+			" * Closure of the generators. Elements are looked up in an open addressing table of positions in group, keyed by\n"
+			" * permutation rank and kept at most half full, so every product costs O(R^2) instead of a scan of the group.\n"
+			" */\n"
+			"template<size_t R, size_t N>\n"
+			"static constexpr std::vector<Symmetry<R>> generateGroup(std::array<Symmetry<R>, N> const& generators) {\n"
+			"    std::vector<Symmetry<R>> group(1);\n"
+			"    group[0].sign = +1;\n"
+			"    std::iota(group[0].values.begin(), group[0].values.end(), size_t(0));\n"
+			"    std::vector<size_t> keys(16);\n"
+			"    std::vector<size_t> positions(16, std::numeric_limits<size_t>::max());\n"
+			"    auto const slotOf = [&keys, &positions](size_t key) {\n"
+			"        size_t const mask = positions.size() - 1;\n"
+			"        size_t slot = ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;\n"
+			"        while (positions[slot] != std::numeric_limits<size_t>::max() && keys[slot] != key) {\n"
+			"            slot = (slot + 1) & mask;\n"
+			"        }\n"
+			"        return slot;\n"
+			"    };\n"
+			"    auto const insert = [&](size_t key, size_t position) {\n"
+			"        size_t const slot = slotOf(key);\n"
+			"        keys[slot] = key;\n"
+			"        positions[slot] = position;\n"
+			"    };\n"
+			"    insert(permutationRank<R>(group[0].values), 0);\n"
+			"    for (size_t n = 0; n < group.size(); n++) {\n"
+			"        for (auto const& generator : generators) {\n"
+			"            Symmetry<R> product;\n"
+			"            product.sign = group[n].sign * generator.sign;\n"
+			"            for (size_t r = 0; r < R; r++) {\n"
+			"                product.values[r] = group[n].values[generator.values[r]];\n"
+			"            }\n"
+			"            size_t const key = permutationRank<R>(product.values);\n"
+			"            size_t const slot = slotOf(key);\n"
+			"            if (positions[slot] == std::numeric_limits<size_t>::max()) {\n"
+			"                group.push_back(product);\n"
+			"                if (2 * group.size() > positions.size()) {\n"
+			"                    keys.assign(2 * positions.size(), 0);\n"
+			"                    positions.assign(keys.size(), std::numeric_limits<size_t>::max());\n"
+			"                    for (size_t g = 0; g < group.size(); g++) {\n"
+			"                        insert(permutationRank<R>(group[g].values), g);\n"
+			"                    }\n"
+			"                } else {\n"
+			"                    keys[slot] = key;\n"
+			"                    positions[slot] = group.size() - 1;\n"
+			"                }\n"
+			"            } else if (group[positions[slot]].sign != product.sign) {\n"
+			"                group[0].sign = 0;\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    return group;\n"
+			"}\n"
+			"\n"
+			"template<size_t R>\n"
+			"struct SlotBlocks {\n"
+			"    bool closedForm = false;\n"
+			"    size_t count = 0;\n"
+			"    std::array<size_t, R> sizes = { };\n"
+			"    std::array<int, R> signs = { };\n"
+			"    std::array<size_t, R> offsets = { };\n"
+			"    std::array<size_t, R> slots = { };\n"
+			"};\n"
+			"\n"
+			"template<size_t R, size_t N>\n"
+			"static constexpr SlotBlocks<R> slotBlocks(std::array<Symmetry<R>, N> const& group) {\n"
+			"    SlotBlocks<R> blocks;\n"
+			"    std::array<size_t, R> root = { };\n"
+			"    std::iota(root.begin(), root.end(), size_t(0));\n"
+			"    auto const find = [&root](size_t r) {\n"
+			"        while (root[r] != r) {\n"
+			"            r = root[r];\n"
+			"        }\n"
+			"        return r;\n"
+			"    };\n"
+			"    for (auto const& element : group) {\n"
+			"        for (size_t r = 0; r < R; r++) {\n"
+			"            size_t const a = find(r);\n"
+			"            size_t const b = find(element.values[r]);\n"
+			"            root[std::max(a, b)] = std::min(a, b);\n"
+			"        }\n"
+			"    }\n"
+			"    size_t order = 1;\n"
+			"    size_t slot = 0;\n"
+			"    for (size_t r = 0; r < R; r++) {\n"
+			"        if (find(r) == r) {\n"
+			"            size_t const b = blocks.count++;\n"
+			"            blocks.offsets[b] = slot;\n"
+			"            blocks.signs[b] = +1;\n"
+			"            for (size_t s = r; s < R; s++) {\n"
+			"                if (find(s) == r) {\n"
+			"                    blocks.slots[slot++] = s;\n"
+			"                    blocks.sizes[b]++;\n"
+			"                    order *= blocks.sizes[b];\n"
+			"                }\n"
+			"            }\n"
+			"            if (blocks.sizes[b] > 1) {\n"
+			"                std::array<size_t, R> transposition = { };\n"
+			"                std::iota(transposition.begin(), transposition.end(), size_t(0));\n"
+			"                std::swap(transposition[blocks.slots[slot - blocks.sizes[b]]], transposition[blocks.slots[slot - blocks.sizes[b] + 1]]);\n"
+			"                for (auto const& element : group) {\n"
+			"                    if (element.values == transposition) {\n"
+			"                        blocks.signs[b] = element.sign;\n"
+			"                    }\n"
+			"                }\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    blocks.closedForm = (N == order) && (group[0].sign == +1);\n"
+			"    return blocks;\n"
+			"}\n"
+			"\n"
+			"template<size_t D, size_t R, auto...S>\n"
+			"static constexpr auto genIndexMap(Symmetries<R, S...> const&) {\n"
+			"    constexpr auto const& group = Symmetries<R, S...>::group;\n"
+			"    constexpr size_t Size = []() {\n"
+			"        size_t size = 1;\n"
+			"        for (size_t r = 0; r < R; r++) {\n"
+			"            size *= D;\n"
+			"        }\n"
+			"        return size;\n"
+			"    }();\n"
+			"    std::array<size_t, Size> map = { 0 };\n"
+			"    std::array<int, Size> sgn = { 0 };\n"
 			"    std::array<bool, Size> visited = { false };\n"
-			"    size_t s = Size;\n"
+			"    std::array<size_t, group.size()> orbit = { 0 };\n"
 			"    std::array<size_t, R> indices = { 0 };\n"
 			"    auto const I2i = [](std::array<size_t, R> indices) {\n"
 			"        size_t i = 0;\n"
@@ -148,63 +201,34 @@ void indexMap2Header(CodeGen &code) {
 			"        return i;\n"
 			"    };\n"
 			"    auto const permuteIndices = [](std::array<size_t, R> indices, std::array<size_t, R> permutation) {\n"
-			"        std::array<size_t, R> result;\n"
+			"        std::array<size_t, R> result = { 0 };\n"
 			"        for (size_t r = 0; r < R; r++) {\n"
 			"            result[r] = indices[permutation[r]];\n"
 			"        }\n"
 			"        return result;\n"
 			"    };\n"
 			"    size_t nextIndex = 0;\n"
-			"    while (s--) {\n"
-			"        size_t index = I2i(indices);\n"
+			"    for (size_t index = 0; index < Size; index++) {\n"
 			"        if (!visited[index]) {\n"
-			"            static constexpr size_t symCount = (1 << N);\n"
-			"            std::array<int, symCount> signs = { 0 };\n"
-			"            std::array<size_t, symCount> theseIndexes;\n"
 			"            bool zero = false;\n"
-			"            for (size_t bits = 0; bits < symCount; bits++) {\n"
-			"                int sgn = +1;\n"
-			"                size_t theseBits = bits;\n"
-			"                auto theseIndices = indices;\n"
-			"                for (size_t k = 0; k < N; k++) {\n"
-			"                    if (theseBits & 1) {\n"
-			"                        theseIndices = permuteIndices(theseIndices, sym.symmetries[k].values);\n"
-			"                        if (sym.symmetries[k].sign < 0) {\n"
-			"                            if (theseIndices == indices) {\n"
-			"                                sgn = 0;\n"
-			"                                zero = true;\n"
-			"                            } else {\n"
-			"                                sgn = -sgn;\n"
-			"                            }\n"
-			"                        }\n"
-			"                    }\n"
-			"                    theseBits >>= 1;\n"
-			"                }\n"
-			"                signs[bits] = sgn;\n"
-			"                size_t const thisIndex = I2i(theseIndices);\n"
-			"                theseIndexes[bits] = thisIndex;\n"
-			"                visited[thisIndex] = true;\n"
-			"            }\n"
-			"            for (size_t bits = 0; bits < symCount; bits++) {\n"
-			"                if (!zero) {\n"
-			"                    map[theseIndexes[bits]] = nextIndex;\n"
-			"                    sgn[theseIndexes[bits]] = signs[bits];\n"
-			"                } else {\n"
-			"                    map[theseIndexes[bits]] = std::numeric_limits<size_t>::max();\n"
-			"                    sgn[theseIndexes[bits]] = 0;\n"
-			"                }\n"
+			"            for (size_t g = 0; g < group.size(); g++) {\n"
+			"                orbit[g] = I2i(permuteIndices(indices, group[g].values));\n"
+			"                zero = zero || ((orbit[g] == index) && (group[g].sign != +1));\n"
+			"            }\n"
+			"            for (size_t g = 0; g < group.size(); g++) {\n"
+			"                visited[orbit[g]] = true;\n"
+			"                map[orbit[g]] = zero ? std::numeric_limits<size_t>::max() : nextIndex;\n"
+			"                sgn[orbit[g]] = zero ? 0 : group[g].sign;\n"
 			"            }\n"
 			"            if (!zero) {\n"
 			"                nextIndex++;\n"
 			"            }\n"
 			"        }\n"
-			"        if (s) {\n"
-			"            std::reverse(indices.begin(), indices.end());\n"
-			"            int r = 0;\n"
-			"            while (++indices[r] == D) {\n"
-			"                indices[r++] = 0;\n"
+			"        for (size_t r = R; r > 0; r--) {\n"
+			"            if (++indices[r - 1] < D) {\n"
+			"                break;\n"
 			"            }\n"
-			"            std::reverse(indices.begin(), indices.end());\n"
+			"            indices[r - 1] = 0;\n"
 			"        }\n"
 			"    }\n"
 			"    return std::make_tuple(map, sgn, nextIndex);\n"
@@ -218,11 +242,11 @@ void indexMap2Header(CodeGen &code) {
 	code.print("size_t index = 0;");
 	code.print("for (size_t j = 0; j < M; j++) {");
 	code.indent();
-	code.print("if (!visited[map[j]]) {");
-	code.indent();
 	code.print("if (sgn[j] == +1) {");
 	code.indent();
-	code.print("size_t k = map[j];");
+	code.print("if (!visited[map[j]]) {");
+	code.indent();
+	code.print("size_t k = j;");
 	code.print("for (size_t r = R; r > 0; r--) {");
 	code.indent();
 	code.print("tuples[index][r - 1] = k % D;");
@@ -242,23 +266,27 @@ void indexMap2Header(CodeGen &code) {
 	code.print("}");
 }
 
-std::string tensorTypeString(int rank) {
-	std::string str = "Tensor<T, D, " + std::to_string(rank);
+std::string tensorTypeString(int rank, bool view = false) {
+	std::string str = (view ? "TensorView<T, D, " : "Tensor<T, D, ") + std::to_string(rank);
 	str += ", S...>";
 	return str;
 }
 
-void TensorDeclaration(CodeGen &code, int rank) {
+void TensorDeclaration(CodeGen &code, int rank, bool view = false, bool slices = true) {
 	std::string str;
-	auto const typeString = tensorTypeString(rank);
+	auto const typeString = tensorTypeString(rank, view);
 	code.print("template<typename T, size_t D, auto...S>");
 	code.print("struct %s {", typeString);
 	code.indent();
-	auto const accessOp = [&code, rank](bool constVersion) {
+	if (view) {
+		code.print("constexpr TensorView(T*, size_t = 1);");
+		code.print("constexpr TensorView(Tensor<std::remove_const_t<T>, D, %i, S...>&);", rank);
+		code.print("constexpr TensorView(Tensor<std::remove_const_t<T>, D, %i, S...> const&) requires std::is_const_v<T>;", rank);
+		code.print("constexpr TensorView(TensorView<std::remove_const_t<T>, D, %i, S...> const&) requires std::is_const_v<T>;", rank);
+	}
+	auto const accessOp = [&code, rank, slices](bool constVersion) {
 		std::string str;
-		str = "constexpr T";
-		str += constVersion ? " const" : "";
-		str += "& operator()(";
+		str = "constexpr decltype(auto) operator()(";
 		for (int r = 0; r < rank; r++) {
 			str += "size_t";
 			str += (r + 1 < rank) ? ", " : "";
@@ -267,7 +295,7 @@ void TensorDeclaration(CodeGen &code, int rank) {
 		str += constVersion ? " const;" : ";";
 		code.print(str);
 		size_t count = 1 << rank;
-		for (size_t bits = 1; bits < count; bits++) {
+		for (size_t bits = slices ? 1 : std::max(size_t(1), count - 1); bits < count; bits++) {
 			std::string str;
 			str = "template<";
 			bool first = true;
@@ -306,11 +334,21 @@ void TensorDeclaration(CodeGen &code, int rank) {
 			code.print(str);
 		}
 	};
-	accessOp(false);
+	if (!view) {
+		accessOp(false);
+	}
 	accessOp(true);
+	code.print("static constexpr size_t size();");
+	if (view) {
+		code.print("constexpr T* data() const;");
+		code.print("constexpr size_t stride() const;");
+	} else {
+		code.print("constexpr T* data();");
+		code.print("constexpr T const* data() const;");
+	}
 	code.print("private:");
 	code.print("static constexpr Symmetries<%i, S...> Syms{};", rank);
-	str = "static constexpr int computeIndex(";
+	str = "static constexpr size_t computeIndex(";
 	for (int r = 0; r < rank; r++) {
 		str += "size_t ";
 		str.push_back('i' + r);
@@ -320,40 +358,27 @@ void TensorDeclaration(CodeGen &code, int rank) {
 	}
 	str += ");";
 	code.print(str);
-	int genRank = rank;
-	str = "static constexpr size_t Size = ";
-	if (genRank) {
-		if (genRank > 1) {
-			str += "(";
-		}
-		str += "D";
-		for (int d = 1; d < genRank; d++) {
-			str += " * D";
-		}
-		if (genRank > 1) {
-			str += ")";
-		}
+	code.print("static constexpr size_t Size = packedSizeOf<D, Symmetries<%i, S...>>;", rank);
+	if (view) {
+		code.print("T* V;");
+		code.print("size_t Stride;");
 	} else {
-		str += "1";
+		code.print("alignas(storageAlignment<T, Size>) std::array<T, Size> V;");
 	}
-	str += ";";
-	code.print(str);
-	code.print("std::array<T, Size> V;");
 	code.dedent();
 	code.print("};");
 	code.newline();
 }
 
-void TensorImplementation(CodeGen &code, int rank) {
+void TensorImplementation(CodeGen &code, int rank, bool view = false, bool slices = true) {
 	std::string str;
 	int genRank = rank;
-	auto const typeString = tensorTypeString(rank);
-	auto const accessOp = [&code, rank, typeString](bool constVersion) {
+	auto const typeString = tensorTypeString(rank, view);
+	std::string const offset = view ? "Stride * " : "";
+	auto const accessOp = [&code, rank, slices, typeString, view, offset](bool constVersion) {
 		std::string str;
 		code.print("template<typename T, size_t D, auto...S>");
-		str = "constexpr T";
-		str += constVersion ? " const" : "";
-		str += "& " + typeString + "::operator()(";
+		str = "constexpr decltype(auto) " + typeString + "::operator()(";
 		for (int r = 0; r < rank; r++) {
 			str += "size_t ";
 			str.push_back('i' + r);
@@ -366,53 +391,52 @@ void TensorImplementation(CodeGen &code, int rank) {
 		str += " {";
 		code.print(str);
 		code.indent();
-		code.print("static constexpr Symmetries<%i, S...> symmetries;", rank);
-		code.print("static constexpr auto indexMap = genIndexMap(symmetries);");
-		str = "int const index = computeIndex(";
+		code.print("if constexpr (sizeof...(S)) {");
+		code.indent();
+		str = "auto const [index, sign] = packedIndex<D>(Syms, {";
 		for (int r = 0; r < rank; r++) {
 			str.push_back('i' + r);
 			if (r + 1 < rank) {
 				str += ", ";
 			}
 		}
-		str += ");";
+		str += "});";
 		code.print(str);
-		code.print("if constexpr (symmetries.hasAsymmetry) {");
+		code.print("if constexpr (Syms.hasAsymmetry) {");
 		code.indent();
-		code.print("index = std::get<0>(indexMap)[index];");
-		code.print("if ( std::get<1>(indexMap)[index] > 0) {");
+		code.print("if constexpr (Size) {");
 		code.indent();
-		code.print("return V[ std::get<0>(indexMap)[index]];");
+		code.print("return signedComponent(%s + %sindex, sign);", view ? "V" : "V.data()", offset);
 		code.dedent();
-		code.print("} else if (std::get<1>(indexMap)[index] < 0) {");
-		code.indent();
-		code.print("return -V[std::get<0>(indexMap)[index]];");
-		code.dedent();
-		code.print("} else/*if (std::get<1>(indexMap)[index] == 0)*/{");
+		code.print("} else {");
 		code.indent();
-		if (constVersion) {
-			code.print("static constexpr T zero = T(0);");
-		} else {
-			code.print("static thread_local T zero;");
-			code.print("zero = T(0);");
-		}
-		code.print("return zero;");
+		code.print("return T(0);");
 		code.dedent();
 		code.print("}");
 		code.dedent();
-		code.print("} else if constexpr (sizeof...(S)) {");
+		code.print("} else {");
 		code.indent();
-		code.print("return V[indexMap.first[index]];");
+		code.print("return V[%sindex];", offset);
+		code.dedent();
+		code.print("}");
 		code.dedent();
 		code.print("} else {");
 		code.indent();
-		code.print("return V[index];");
+		str = "return V[" + offset + "computeIndex(";
+		for (int r = 0; r < rank; r++) {
+			str.push_back('i' + r);
+			if (r + 1 < rank) {
+				str += ", ";
+			}
+		}
+		str += ")];";
+		code.print(str);
 		code.dedent();
 		code.print("}");
 		code.dedent();
 		code.print("}");
 		size_t count = 1 << rank;
-		for (size_t bits = 1; bits < count; bits++) {
+		for (size_t bits = slices ? 1 : std::max(size_t(1), count - 1); bits < count; bits++) {
 			std::string str;
 			code.newline();
 			code.print("template<typename T, size_t D, auto...S>");
@@ -454,47 +478,73 @@ void TensorImplementation(CodeGen &code, int rank) {
 			code.print(str);
 			code.indent();
 
-			str = "auto f = [this";
-			for (int r = 0; r < rank; r++) {
-				if (!((bits >> r) & 1)) {
-					str += ", ";
-					str.push_back('i' + r);
+			if (bits + 1 == count) {
+				code.print("using handle_type = TensorAccess<std::remove_pointer_t<decltype(this)>>;");
+				code.print("return TensorExpression<handle_type, D, %i, Symmetries<%i, S...>, %s>(handle_type { this });", rank, rank, charString2);
+			} else {
+				str = "auto f = [this";
+				for (int r = 0; r < rank; r++) {
+					if (!((bits >> r) & 1)) {
+						str += ", ";
+						str.push_back('i' + r);
+					}
 				}
-			}
-			str += "](";
-			first = true;
-			for (int r = 0; r < rank; r++) {
-				if ((bits >> r) & 1) {
+				str += "](";
+				first = true;
+				for (int r = 0; r < rank; r++) {
+					if ((bits >> r) & 1) {
+						str += !first ? ", " : "";
+						str += "size_t ";
+						str.push_back('i' + r);
+						first = false;
+					}
+				}
+				str += ") -> decltype(auto) {";
+				code.print(str);
+				code.indent();
+				str = "";
+				first = true;
+				for (int r = 0; r < rank; r++) {
 					str += !first ? ", " : "";
-					str += "size_t ";
 					str.push_back('i' + r);
 					first = false;
 				}
+				code.print("return this->operator()(%s);", str);
+				code.dedent();
+				code.print("};");
+				int const sliceRank = std::popcount(bits);
+				code.print("return TensorExpression<decltype(f), D, %i, Symmetries<%i>, %s>(std::move(f));", sliceRank, sliceRank, charString2);
 			}
-			str += ") {";
-			code.print(str);
-			code.indent();
-			str = "";
-			first = true;
-			for (int r = 0; r < rank; r++) {
-				str += !first ? ", " : "";
-				str.push_back('i' + r);
-				first = false;
-			}
-			code.print("return this->operator()(%s);", str);
-			code.dedent();
-			code.print("};");
-			code.print("return TensorExpression<decltype(f), D, %i, Symmetries<%i, S...>, %s>(std::move(f));", rank, rank, charString2);
 			code.dedent();
 			code.print("}");
 		}
 	};
-	accessOp(false);
-	code.newline();
+	if (view) {
+		std::string const tensorString = "Tensor<std::remove_const_t<T>, D, " + std::to_string(rank) + ", S...>";
+		code.print("template<typename T, size_t D, auto...S>");
+		code.print("constexpr %s::TensorView(T* data, size_t stride) : V(data), Stride(stride) {", typeString);
+		code.print("}");
+		code.newline();
+		code.print("template<typename T, size_t D, auto...S>");
+		code.print("constexpr %s::TensorView(%s& tensor) : V(tensor.data()), Stride(1) {", typeString, tensorString);
+		code.print("}");
+		code.newline();
+		code.print("template<typename T, size_t D, auto...S>");
+		code.print("constexpr %s::TensorView(%s const& tensor) requires std::is_const_v<T> : V(tensor.data()), Stride(1) {", typeString, tensorString);
+		code.print("}");
+		code.newline();
+		code.print("template<typename T, size_t D, auto...S>");
+		code.print("constexpr %s::TensorView(TensorView<std::remove_const_t<T>, D, %i, S...> const& other) requires std::is_const_v<T> : V(other.data()), Stride(other.stride()) {", typeString, rank);
+		code.print("}");
+		code.newline();
+	} else {
+		accessOp(false);
+		code.newline();
+	}
 	accessOp(true);
 	code.newline();
 	code.print("template<typename T, size_t D, auto...S>");
-	str = "constexpr int " + typeString + "::computeIndex(";
+	str = "constexpr size_t " + typeString + "::computeIndex(";
 	for (int r = 0; r < rank; r++) {
 		str += "size_t ";
 		str.push_back('i' + r);
@@ -503,8 +553,8 @@ void TensorImplementation(CodeGen &code, int rank) {
 		}
 	}
 	str += ") {";
-	code.indent();
 	code.print(str);
+	code.indent();
 	str = "size_t index = ";
 	if (genRank == 0) {
 		str += "0";
@@ -526,6 +576,44 @@ void TensorImplementation(CodeGen &code, int rank) {
 	code.dedent();
 	code.print("}");
 	code.newline();
+	code.print("template<typename T, size_t D, auto...S>");
+	code.print("constexpr size_t %s::size() {", typeString);
+	code.indent();
+	code.print("return Size;");
+	code.dedent();
+	code.print("}");
+	code.newline();
+	if (view) {
+		code.print("template<typename T, size_t D, auto...S>");
+		code.print("constexpr T* %s::data() const {", typeString);
+		code.indent();
+		code.print("return V;");
+		code.dedent();
+		code.print("}");
+		code.newline();
+		code.print("template<typename T, size_t D, auto...S>");
+		code.print("constexpr size_t %s::stride() const {", typeString);
+		code.indent();
+		code.print("return Stride;");
+		code.dedent();
+		code.print("}");
+		code.newline();
+		return;
+	}
+	code.print("template<typename T, size_t D, auto...S>");
+	code.print("constexpr T* %s::data() {", typeString);
+	code.indent();
+	code.print("return V.data();");
+	code.dedent();
+	code.print("}");
+	code.newline();
+	code.print("template<typename T, size_t D, auto...S>");
+	code.print("constexpr T const* %s::data() const {", typeString);
+	code.indent();
+	code.print("return V.data();");
+	code.dedent();
+	code.print("}");
+	code.newline();
 }
 
 void expressionDeclaration(CodeGen &code, int rank) {
@@ -538,28 +626,35 @@ void expressionDeclaration(CodeGen &code, int rank) {
 	str += ">";
 	code.print(str);
 	str = "";
-	std::vector<char> charString;
 	for (int r = 0; r < rank; r++) {
 		str += ", ";
 		str.push_back('I' + r);
-		charString.push_back('I' + r);
 	}
 	code.print("struct TensorExpression<T, D, %i, S0%s> {", rank, str);
 	code.indent();
 	code.print("TensorExpression(T);");
+	code.print("TensorExpression(TensorExpression const&) = default;");
 	code.print("static constexpr S0 Syms{};");
-	do {
-		code.print("template<typename S1>");
-		str = "constexpr auto operator=(TensorExpression<T, D, " + std::to_string(rank) + ", S1";
-		for (int r = 0; r < rank; r++) {
-			str += ", ";
-			str.push_back(charString[r]);
-		}
-		str += "> const&);";
-		code.print(str);
-
-	} while (std::next_permutation(charString.begin(), charString.end()));
+	str = "constexpr decltype(auto) operator()(";
+	for (int r = 0; r < rank; r++) {
+		str += r ? ", " : "";
+		str += "size_t";
+	}
+	str += ") const;";
+	code.print(str);
+	if (rank == 0) {
+		code.print("constexpr operator auto() const;");
+	}
+	code.print("constexpr void operator=(TensorExpression const&);");
+	code.print("template<typename T1, typename S1, char...I1>");
+	code.print("constexpr auto operator=(TensorExpression<T1, D, %i, S1, I1...> const&);", rank);
+	code.print("template<typename Policy, typename T1, typename S1, char...I1>");
+	code.print("constexpr auto assign(Policy const&, TensorExpression<T1, D, %i, S1, I1...> const&);", rank);
 	code.print("private:");
+	code.print("template<typename, size_t, size_t, typename, char...>");
+	code.print("friend struct TensorExpression;");
+	code.print("template<typename, typename>");
+	code.print("friend struct Contraction;");
 	code.print("T handle;");
 	code.dedent();
 	code.print("};");
@@ -576,14 +671,12 @@ void expressionImplementation(CodeGen &code, int rank) {
 	}
 	str += ">";
 	std::string const tempStr1 = str;
-	std::string const tempStr2 = "template<typename S1>";
+	std::string const tempStr2 = "template<typename T1, typename S1, char...I1>";
 	code.print(str);
 	str = "";
-	std::vector<char> charString;
 	for (int r = 0; r < rank; r++) {
 		str += ", ";
 		str.push_back('I' + r);
-		charString.push_back('I' + r);
 	}
 	std::string const typeString = "TensorExpression<T, D, " + std::to_string(rank) + ", S0" + str;
 	code.print("%s>::TensorExpression(T h) : handle(h) {", typeString);
@@ -591,25 +684,54 @@ void expressionImplementation(CodeGen &code, int rank) {
 	code.dedent();
 	code.print("}");
 	code.newline();
-	do {
+	code.print("%s", tempStr1);
+	str = "constexpr decltype(auto) " + typeString + ">::operator()(";
+	for (int r = 0; r < rank; r++) {
+		str += r ? ", " : "";
+		str += "size_t ";
+		str.push_back('i' + r);
+	}
+	str += ") const {";
+	code.print(str);
+	code.indent();
+	str = "return handle(";
+	for (int r = 0; r < rank; r++) {
+		str += r ? ", " : "";
+		str.push_back('i' + r);
+	}
+	str += ");";
+	code.print(str);
+	code.dedent();
+	code.print("}");
+	code.newline();
+	if (rank == 0) {
 		code.print("%s", tempStr1);
-		code.print("%s", tempStr2);
-		str = "constexpr auto " + typeString + ">::operator=(TensorExpression<T, D, " + std::to_string(rank) + ", S1";
-		for (int r = 0; r < rank; r++) {
-			str += ", ";
-			str.push_back(charString[r]);
-		}
-		str += "> const& other) {";
-		code.print(str);
+		code.print("constexpr %s>::operator auto() const {", typeString);
 		code.indent();
-		if (rank) {
-			code.print("static constexpr S0 symmetries{};");
-			code.print("static constexpr auto indexMap = genIndexMap(symmetries);");
-			code.print("static constexpr size_t NN = std::get<2>(indexMap);");
-			code.print("static constexpr size_t MM = std::get<0>(indexMap).size();");
-			code.print("static constexpr auto tuples = uniqueTuples<D, %i, NN, MM>(std::get<0>(indexMap), std::get<1>(indexMap));", rank);
-			code.print("for (auto const& indices : tuples) {");
+		code.print("return handle();");
+		code.dedent();
+		code.print("}");
+		code.newline();
+	}
+	auto const assignmentBody = [&code, rank](bool permuted, bool loop = true) {
+		std::string str;
+		if (permuted) {
+			str = "constexpr auto const& slots = LabelsOf<" + std::to_string(rank);
+			for (int r = 0; r < rank; r++) {
+				str += ", ";
+				str.push_back('I' + r);
+			}
+			str += ">::template slots<I1...>;";
+			code.print(str);
+			if (loop) {
+				code.print("auto const& source = evaluated(other.handle);");
+			}
+		}
+		if (rank && loop) {
+			code.print("for (auto const& indices : UniqueTuples<D, S0> { }) {");
 			code.indent();
+		}
+		if (rank) {
 			str = "auto const [";
 			for (int r = 0; r < rank; r++) {
 				str += r ? ", " : "";
@@ -625,152 +747,2165 @@ void expressionImplementation(CodeGen &code, int rank) {
 			char const c = 'i' + r;
 			str.push_back(c);
 		}
-		str += ") = other(";
+		str += permuted ? ") = source(" : ") = other(";
 		for (int r = 0; r < rank; r++) {
 			str += r ? ", " : "";
-			str.push_back(charString[r] + 'a' - 'A');
+			if (permuted) {
+				str += "indices[slots[" + std::to_string(r) + "]]";
+			} else {
+				str.push_back('i' + r);
+			}
 		}
 		str += ");";
 		code.print(str);
-		if (rank) {
+		if (rank && loop) {
 			code.dedent();
 			code.print("}");
 		}
-		code.dedent();
-		code.print("}");
-		code.newline();
-	} while (std::next_permutation(charString.begin(), charString.end()));
-	code.newline();
-}
-
-void forwardDeclarations(CodeGen &code) {
-	code.newline();
-	code.print("template<size_t>");
-	code.print("struct Symmetry;");
-	code.newline();
-	code.print("template<size_t, auto...>");
-	code.print("struct Symmetries;");
-	code.newline();
-	code.print("template<char>");
-	code.print("struct Index;");
-	code.newline();
-	code.print("template<typename, size_t, size_t R, auto...S>");
-	code.print("struct Tensor;");
-	code.newline();
-	code.print("template<typename, size_t, size_t, typename, char...>");
-	code.print("struct TensorExpression;");
-	code.newline();
-	indexMapDeclaration(code);
-}
-
-void helpers(CodeGen &code) {
-	code.newline();
-	code.print("template<char C>");
-	code.print("struct Index {");
-	code.indent();
-	code.print("static constexpr char value = C;");
-	code.dedent();
-	code.print("};");
-	indexMap2Header(code);
-	code.print("");
-	code.print("template<size_t R>");
-	code.print("struct Symmetry {");
-	code.indent();
-	code.print("private:");
-	code.print("int const sign;");
-	code.print("std::array<size_t, R> const values;");
-	code.print("static constexpr std::array<size_t, R> iota = [] {");
+	};
+	code.print("%s", tempStr1);
+	code.print("constexpr void %s>::operator=(TensorExpression const& other) {", typeString);
 	code.indent();
-	code.print("std::array<size_t, R> r = { };");
-	code.print("std::iota(r.begin(), r.end(), size_t(0));");
-	code.print("return r;");
+	assignmentBody(false);
 	code.dedent();
-	code.print("}();");
-	code.print("Symmetry(int s, std::array<size_t, R> const& v ) : sign(s), values(v) {");
+	code.print("}");
+	code.newline();
+	code.print("%s", tempStr1);
+	code.print("%s", tempStr2);
+	code.print("constexpr auto %s>::operator=(TensorExpression<T1, D, %i, S1, I1...> const& other) {", typeString, rank);
 	code.indent();
-	code.print("static_assert(std::is_permutation(values.begin(), values.end(), iota.begin()));");
+	assignmentBody(true);
 	code.dedent();
 	code.print("}");
-	code.dedent();
-	code.print("};");
 	code.newline();
-	code.print("template<size_t R, auto...I>");
-	code.print("struct Symmetries { ");
-	code.indent();
-	code.print("static constexpr size_t Size = sizeof...(I) / (size_t(1) + R);");
-	code.print("static constexpr auto symmetries = []() { ");
+	code.print("%s", tempStr1);
+	code.print("template<typename Policy, typename T1, typename S1, char...I1>");
+	code.print("constexpr auto %s>::assign(Policy const& policy, TensorExpression<T1, D, %i, S1, I1...> const& other) {", typeString, rank);
 	code.indent();
-	code.print("std::array<Symmetry<R>, Size> syms;");
-	code.print("static constexpr size_t m = R + size_t(1);");
-	code.print("size_t i = -1;");
-	code.print("((((++i % m == 0) ? syms[i / m].sign : syms[i / m].values[(i % m) - 1]) = I), ...);");
-	code.print("return syms;");
-	code.dedent();
-	code.print("}();");
-	code.print("static constexpr bool hasAsymmetry = []() {");
+	str = "using value_type = component_type<decltype(handle(";
+	for (int r = 0; r < rank; r++) {
+		str += r ? ", " : "";
+		str += "size_t(0)";
+	}
+	str += "))>;";
+	code.print(str);
+	code.print("auto const& source = evaluated(other.handle);");
+	code.print("forEachUnique<D, S0, sizeof(value_type)>(policy, [this, &source](std::array<size_t, %i> const& indices) {", rank);
 	code.indent();
-	code.print("static constexpr size_t m = R + size_t(1);");
-	code.print("bool rc = false;");
-	code.print("size_t i = -1;");
-	code.print("((rc = ((I < 0) && (++i % m == 0)) || rc), ...);");
-	code.print("return rc;");
+	assignmentBody(true, false);
 	code.dedent();
-	code.print("}();");
+	code.print("});");
 	code.dedent();
-	code.print("};");
+	code.print("}");
+	code.newline();
+}
+
+void labelsHeader(CodeGen &code) {
+	const char *codeString =
+			"template<size_t R, size_t M>\n"
+			"static constexpr std::array<size_t, R> gatherIndices(std::array<size_t, M> const& indices, std::array<size_t, R> const& slots) {\n"
+			"    std::array<size_t, R> result = { };\n"
+			"    for (size_t r = 0; r < R; r++) {\n"
+			"        result[r] = indices[slots[r]];\n"
+			"    }\n"
+			"    return result;\n"
+			"}\n"
+			"\n"
+			"template<size_t R>\n"
+			"static constexpr std::array<size_t, R> labelPermutation(std::array<char, R> const& to, std::array<char, R> const& from) {\n"
+			"    std::array<size_t, R> slots = { };\n"
+			"    for (size_t r = 0; r < R; r++) {\n"
+			"        auto const it = std::find(to.begin(), to.end(), from[r]);\n"
+			"        if (it == to.end() || std::count(from.begin(), from.end(), from[r]) != 1) {\n"
+			"            throw std::invalid_argument(\"Both sides must carry the same index labels.\");\n"
+			"        }\n"
+			"        slots[r] = it - to.begin();\n"
+			"    }\n"
+			"    return slots;\n"
+			"}\n"
+			"\n"
+			"template<size_t R, char...I>\n"
+			"struct LabelsOf {\n"
+			"    template<char...J>\n"
+			"    static constexpr std::array<size_t, R> slots = labelPermutation<R>(std::array<char, R> { I... }, std::array<char, R> { J... });\n"
+			"};\n";
+	code.stringToFile(codeString);
+}
+
+void contractionImplementation(CodeGen &code) {
+	const char *codeString =
+			"static constexpr size_t contractionUnrollLimit = 64;\n"
+			"\n"
+			"template<size_t R1, size_t R2>\n"
+			"struct ContractionPattern {\n"
+			"    static constexpr size_t N = R1 + R2;\n"
+			"    size_t freeCount = 0;\n"
+			"    size_t sumCount = 0;\n"
+			"    std::array<char, N> freeLabels = { };\n"
+			"    std::array<char, N> sumLabels = { };\n"
+			"    std::array<size_t, R1> lhsSlots = { };\n"
+			"    std::array<size_t, R2> rhsSlots = { };\n"
+			"    constexpr ContractionPattern(std::array<char, N> const& labels) {\n"
+			"        std::array<size_t, N> slots = { };\n"
+			"        for (size_t n = 0; n < N; n++) {\n"
+			"            size_t const count = std::count(labels.begin(), labels.end(), labels[n]);\n"
+			"            if (count > 2) {\n"
+			"                throw std::invalid_argument(\"An index label may appear at most twice in a product.\");\n"
+			"            }\n"
+			"            if (count == 1) {\n"
+			"                slots[n] = freeCount;\n"
+			"                freeLabels[freeCount++] = labels[n];\n"
+			"            }\n"
+			"        }\n"
+			"        for (size_t n = 0; n < N; n++) {\n"
+			"            size_t const first = std::find(labels.begin(), labels.end(), labels[n]) - labels.begin();\n"
+			"            if (std::count(labels.begin(), labels.end(), labels[n]) == 2) {\n"
+			"                if (first == n) {\n"
+			"                    slots[n] = freeCount + sumCount;\n"
+			"                    sumLabels[sumCount++] = labels[n];\n"
+			"                } else {\n"
+			"                    slots[n] = slots[first];\n"
+			"                }\n"
+			"            }\n"
+			"        }\n"
+			"        std::copy(slots.begin(), slots.begin() + R1, lhsSlots.begin());\n"
+			"        std::copy(slots.begin() + R1, slots.end(), rhsSlots.begin());\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"template<size_t R1, size_t R2, char...L>\n"
+			"static constexpr ContractionPattern<R1, R2> contractionPatternOf(std::array<char, R1 + R2> { L... });\n"
+			"\n"
+			"static constexpr size_t powerOf(size_t D, size_t n) {\n"
+			"    size_t c = 1;\n"
+			"    for (size_t k = 0; k < n; k++) {\n"
+			"        c *= D;\n"
+			"    }\n"
+			"    return c;\n"
+			"}\n"
+			"\n"
+			"template<size_t D, size_t F, size_t NS, size_t M, typename Term>\n"
+			"static constexpr auto sumOverIndices(std::array<size_t, M> indices, Term const& term) {\n"
+			"    constexpr size_t count = powerOf(D, NS);\n"
+			"    auto const termAt = [&indices, &term](size_t k) {\n"
+			"        for (size_t n = F + NS; n > F; n--) {\n"
+			"            indices[n - 1] = k % D;\n"
+			"            k /= D;\n"
+			"        }\n"
+			"        return term(indices);\n"
+			"    };\n"
+			"    if constexpr (count <= contractionUnrollLimit) {\n"
+			"        return [&termAt]<size_t...K>(std::index_sequence<K...>) {\n"
+			"            return (termAt(K) + ...);\n"
+			"        }(std::make_index_sequence<count>());\n"
+			"    } else {\n"
+			"        auto sum = termAt(0);\n"
+			"        for (size_t k = 1; k < count; k++) {\n"
+			"            sum += termAt(k);\n"
+			"        }\n"
+			"        return sum;\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"/* Writes the base D digits of value, most significant first, to indices[first, first + count). */\n"
+			"template<size_t D, size_t First, size_t Count, size_t M>\n"
+			"static constexpr void setDigits(std::array<size_t, M>& indices, size_t value) {\n"
+			"    for (size_t n = First + Count; n > First; n--) {\n"
+			"        indices[n - 1] = value % D;\n"
+			"        value /= D;\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"static constexpr size_t tiledContractionThreshold = size_t(1) << 15;\n"
+			"\n"
+			"/*\n"
+			" * Panel sizes of the tiled M x K by K x N product for value type T: one row of C and one row of the packed B panel fill\n"
+			" * half of L1, the packed B panel fills half of L2 and the packed A panel a quarter of it.\n"
+			" */\n"
+			"template<typename T, size_t M, size_t N, size_t K>\n"
+			"struct ContractionTiles {\n"
+			"    static constexpr size_t n = std::clamp(l1CacheSize / (4 * sizeof(T)), size_t(1), N);\n"
+			"    static constexpr size_t k = std::clamp(l2CacheSize / (2 * n * sizeof(T)), size_t(1), K);\n"
+			"    static constexpr size_t m = std::clamp(l2CacheSize / (4 * k * sizeof(T)), size_t(1), M);\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t F>\n"
+			"struct DenseComponents {\n"
+			"    std::vector<T> values;\n"
+			"    constexpr T const& operator()(auto...i) const {\n"
+			"        static_assert(sizeof...(i) == F);\n"
+			"        size_t index = 0;\n"
+			"        ((index = D * index + size_t(i)), ...);\n"
+			"        return values[index];\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"/* Handle of an expression that names every slot of a tensor by an index label. */\n"
+			"template<typename Storage>\n"
+			"struct TensorAccess {\n"
+			"    Storage* tensor;\n"
+			"    constexpr decltype(auto) operator()(auto...i) const {\n"
+			"        return (*tensor)(size_t(i)...);\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"/* Handle of an intermediate of a multi-tensor product, owned by the evaluation of the product. */\n"
+			"template<typename T, size_t D, size_t F>\n"
+			"struct DenseView {\n"
+			"    T const* values;\n"
+			"    constexpr T const& operator()(auto...i) const {\n"
+			"        static_assert(sizeof...(i) == F);\n"
+			"        size_t index = 0;\n"
+			"        ((index = D * index + size_t(i)), ...);\n"
+			"        return values[index];\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"/* Tensors without symmetries and intermediates store their components densely in row-major order. */\n"
+			"template<typename>\n"
+			"struct IsDenseAccess: std::false_type {\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t R>\n"
+			"struct IsDenseAccess<TensorAccess<Tensor<T, D, R>>> : std::true_type {\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t R>\n"
+			"struct IsDenseAccess<TensorAccess<Tensor<T, D, R> const>> : std::true_type {\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t F>\n"
+			"struct IsDenseAccess<DenseView<T, D, F>> : std::true_type {\n"
+			"};\n"
+			"\n"
+			"template<typename S>\n"
+			"static constexpr auto denseData(TensorAccess<S> const& handle) {\n"
+			"    return handle.tensor->data();\n"
+			"}\n"
+			"\n"
+			"template<typename T, size_t D, size_t F>\n"
+			"static constexpr T const* denseData(DenseView<T, D, F> const& handle) {\n"
+			"    return handle.values;\n"
+			"}\n"
+			"\n"
+			"static constexpr size_t saturatingProduct(size_t a, size_t b) {\n"
+			"    return (b && a > std::numeric_limits<size_t>::max() / b) ? std::numeric_limits<size_t>::max() : a * b;\n"
+			"}\n"
+			"\n"
+			"static constexpr size_t saturatingSum(size_t a, size_t b) {\n"
+			"    return (a > std::numeric_limits<size_t>::max() - b) ? std::numeric_limits<size_t>::max() : a + b;\n"
+			"}\n"
+			"\n"
+			"/*\n"
+			" * Pairwise evaluation order of a product of N tensors. Operands 0 to N - 1 are the factors from left to right, operand\n"
+			" * N + s is the result of steps[s]. flops counts one multiply and one add per term of every step, lazyFlops the same for\n"
+			" * summing all labels at once per component of the result.\n"
+			" */\n"
+			"template<size_t N>\n"
+			"struct ContractionPlan {\n"
+			"    static constexpr size_t intermediates = N - 2;\n"
+			"    std::array<std::array<size_t, 2>, N - 1> steps = { };\n"
+			"    size_t flops = 0;\n"
+			"    size_t lazyFlops = 0;\n"
+			"};\n"
+			"\n"
+			"/*\n"
+			" * Optimal order by dynamic programming over subsets of the factors, as opt_einsum does. masks[n] holds the labels of\n"
+			" * factor n that it does not trace itself, output the free labels of the product. A set of factors contracts to a tensor\n"
+			" * of the labels it shares with the other factors or the output, and joining two sets costs 2 D^L for the L labels of\n"
+			" * their union.\n"
+			" */\n"
+			"template<size_t N>\n"
+			"static constexpr ContractionPlan<N> planContraction(size_t D, std::array<uint64_t, N> const& masks, uint64_t output, size_t labelCount) {\n"
+			"    static_assert(N >= 2 && N <= 16, \"Products are planned for 2 to 16 factors.\");\n"
+			"    constexpr size_t full = (size_t(1) << N) - 1;\n"
+			"    auto const flopsOf = [D](uint64_t labels) {\n"
+			"        size_t flops = 2;\n"
+			"        for (int l = std::popcount(labels); l > 0; l--) {\n"
+			"            flops = saturatingProduct(flops, D);\n"
+			"        }\n"
+			"        return flops;\n"
+			"    };\n"
+			"    std::vector<uint64_t> kept(full + 1);\n"
+			"    for (size_t set = 1; set <= full; set++) {\n"
+			"        uint64_t inside = 0;\n"
+			"        uint64_t outside = output;\n"
+			"        for (size_t n = 0; n < N; n++) {\n"
+			"            ((set >> n) & 1 ? inside : outside) |= masks[n];\n"
+			"        }\n"
+			"        kept[set] = inside & outside;\n"
+			"    }\n"
+			"    std::vector<size_t> cost(full + 1, 0);\n"
+			"    std::vector<size_t> split(full + 1, 0);\n"
+			"    for (size_t set = 1; set <= full; set++) {\n"
+			"        if (std::popcount(set) < 2) {\n"
+			"            continue;\n"
+			"        }\n"
+			"        cost[set] = std::numeric_limits<size_t>::max();\n"
+			"        size_t const lowest = set & (~set + 1);\n"
+			"        for (size_t left = (set - 1) & set; left; left = (left - 1) & set) {\n"
+			"            if (!(left & lowest)) {\n"
+			"                continue;\n"
+			"            }\n"
+			"            size_t const right = set ^ left;\n"
+			"            size_t const total = saturatingSum(saturatingSum(cost[left], cost[right]), flopsOf(kept[left] | kept[right]));\n"
+			"            if (total < cost[set]) {\n"
+			"                cost[set] = total;\n"
+			"                split[set] = left;\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    ContractionPlan<N> plan;\n"
+			"    plan.flops = cost[full];\n"
+			"    plan.lazyFlops = 2;\n"
+			"    for (size_t l = 0; l < labelCount; l++) {\n"
+			"        plan.lazyFlops = saturatingProduct(plan.lazyFlops, D);\n"
+			"    }\n"
+			"    size_t step = 0;\n"
+			"    auto const emit = [&plan, &split, &step](auto const& self, size_t set) -> size_t {\n"
+			"        if (std::popcount(set) == 1) {\n"
+			"            return size_t(std::countr_zero(set));\n"
+			"        }\n"
+			"        size_t const left = self(self, split[set]);\n"
+			"        size_t const right = self(self, set ^ split[set]);\n"
+			"        plan.steps[step] = { left, right };\n"
+			"        return N + step++;\n"
+			"    };\n"
+			"    emit(emit, full);\n"
+			"    return plan;\n"
+			"}\n"
+			"\n"
+			"template<typename>\n"
+			"struct ExpressionLabels;\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, typename S, char...I>\n"
+			"struct ExpressionLabels<TensorExpression<T, D, R, S, I...>> {\n"
+			"    static constexpr std::array<char, R> value = { I... };\n"
+			"};\n"
+			"\n"
+			"/* Accesses to one owning tensor type, whose components line up in storage. */\n"
+			"template<typename, typename>\n"
+			"struct IsSameStorage: std::false_type {\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, auto...S, typename S2>\n"
+			"struct IsSameStorage<TensorAccess<Tensor<T, D, R, S...>>, TensorAccess<S2>> : std::is_same<Tensor<T, D, R, S...>, std::remove_const_t<S2>> {\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, auto...S, typename S2>\n"
+			"struct IsSameStorage<TensorAccess<Tensor<T, D, R, S...> const>, TensorAccess<S2>> : std::is_same<Tensor<T, D, R, S...>, std::remove_const_t<S2>> {\n"
+			"};\n"
+			"\n"
+			"template<typename, typename>\n"
+			"struct Contraction;\n"
+			"\n"
+			"/* The factors of a product expression, from left to right, as a tuple type. */\n"
+			"template<typename E>\n"
+			"struct ProductFactors {\n"
+			"    using type = std::tuple<E>;\n"
+			"};\n"
+			"\n"
+			"template<typename E1, typename E2, size_t D, size_t F, typename S, char...L>\n"
+			"struct ProductFactors<TensorExpression<Contraction<E1, E2>, D, F, S, L...>> {\n"
+			"    using type = decltype(std::tuple_cat(std::declval<typename ProductFactors<E1>::type>(), std::declval<typename ProductFactors<E2>::type>()));\n"
+			"};\n"
+			"\n"
+			"/*\n"
+			" * Handle of A * B. Components are summed lazily on access; assignments instead evaluate the whole product with\n"
+			" * evaluate() once it is large enough and every summed label joins one slot of A with one slot of B.\n"
+			" */\n"
+			"template<typename T1, typename T2, size_t D, size_t R1, size_t R2, typename S1, typename S2, char...I, char...J>\n"
+			"struct Contraction<TensorExpression<T1, D, R1, S1, I...>, TensorExpression<T2, D, R2, S2, J...>> {\n"
+			"    static constexpr auto const& pattern = contractionPatternOf<R1, R2, I..., J...>;\n"
+			"    static constexpr size_t F = pattern.freeCount;\n"
+			"    static constexpr size_t NS = pattern.sumCount;\n"
+			"    static constexpr size_t FA = std::count_if(pattern.lhsSlots.begin(), pattern.lhsSlots.end(), [](size_t s) {\n"
+			"        return s < F;\n"
+			"    });\n"
+			"    static constexpr size_t M = powerOf(D, FA);\n"
+			"    static constexpr size_t N = powerOf(D, F - FA);\n"
+			"    static constexpr size_t K = powerOf(D, NS);\n"
+			"    static constexpr bool matrixShaped = (R1 - FA == NS) && (R2 - (F - FA) == NS);\n"
+			"    static constexpr bool tiled = matrixShaped && (NS > 0) && (M * N * K >= tiledContractionThreshold);\n"
+			"    static constexpr bool fullDot = (F == 0) && IsSameStorage<T1, T2>::value && []() {\n"
+			"        if constexpr (R1 == R2) {\n"
+			"            return pattern.lhsSlots == pattern.rhsSlots;\n"
+			"        } else {\n"
+			"            return false;\n"
+			"        }\n"
+			"    }();\n"
+			"    using Factors = decltype(std::tuple_cat(std::declval<typename ProductFactors<TensorExpression<T1, D, R1, S1, I...>>::type>(),\n"
+			"            std::declval<typename ProductFactors<TensorExpression<T2, D, R2, S2, J...>>::type>()));\n"
+			"    static constexpr size_t factorCount = std::tuple_size_v<Factors>;\n"
+			"    static constexpr ContractionPlan<factorCount> plan = []<size_t...Q>(std::index_sequence<Q...>) {\n"
+			"        std::array<char, 64> labels = { };\n"
+			"        size_t labelCount = 0;\n"
+			"        std::array<uint64_t, factorCount> masks = { };\n"
+			"        auto const bitOf = [&labels, &labelCount](char label) {\n"
+			"            size_t const bit = std::find(labels.begin(), labels.begin() + labelCount, label) - labels.begin();\n"
+			"            if (bit == labelCount) {\n"
+			"                if (labelCount == labels.size()) {\n"
+			"                    throw std::invalid_argument(\"A product may carry at most 64 distinct index labels.\");\n"
+			"                }\n"
+			"                labels[labelCount++] = label;\n"
+			"            }\n"
+			"            return uint64_t(1) << bit;\n"
+			"        };\n"
+			"        auto const addFactor = [&bitOf, &masks](auto const& factorLabels, size_t q) {\n"
+			"            for (char label : factorLabels) {\n"
+			"                masks[q] ^= bitOf(label);\n"
+			"            }\n"
+			"        };\n"
+			"        (addFactor(ExpressionLabels<std::tuple_element_t<Q, Factors>>::value, Q), ...);\n"
+			"        uint64_t output = 0;\n"
+			"        for (size_t f = 0; f < F; f++) {\n"
+			"            output |= bitOf(pattern.freeLabels[f]);\n"
+			"        }\n"
+			"        return planContraction<factorCount>(D, masks, output, labelCount);\n"
+			"    }(std::make_index_sequence<factorCount>());\n"
+			"    static constexpr bool planned = (factorCount > 2) && (plan.lazyFlops >= tiledContractionThreshold) && (plan.flops < plan.lazyFlops);\n"
+			"    TensorExpression<T1, D, R1, S1, I...> A;\n"
+			"    TensorExpression<T2, D, R2, S2, J...> B;\n"
+			"    constexpr auto operator()(auto...i) const {\n"
+			"        static_assert(sizeof...(i) == F);\n"
+			"        if constexpr (fullDot) {\n"
+			"            return dot(*A.handle.tensor, *B.handle.tensor);\n"
+			"        } else {\n"
+			"            std::array<size_t, F + NS> const indices = { size_t(i)... };\n"
+			"            return sumOverIndices<D, F, NS>(indices, [this](std::array<size_t, F + NS> const& indices) {\n"
+			"                return std::apply(A, gatherIndices(indices, pattern.lhsSlots)) * std::apply(B, gatherIndices(indices, pattern.rhsSlots));\n"
+			"            });\n"
+			"        }\n"
+			"    }\n"
+			"    /*\n"
+			"     * Reshapes the product to C(M x N) = A(M x K) * B(K x N). Floating-point products that fill at least one register\n"
+			"     * block run on the micro-kernel, everything else, matrix-vector products included, on the panel loop.\n"
+			"     */\n"
+			"    constexpr auto evaluate() const {\n"
+			"        using value_type = std::remove_cvref_t<decltype(std::apply(*this, std::array<size_t, F> { }))>;\n"
+			"        DenseComponents<value_type, D, F> C { std::vector<value_type>(M * N, value_type(0)) };\n"
+			"        if constexpr (std::is_floating_point_v<value_type> && (M >= gemmRows) && (N >= gemmColumns<value_type>)) {\n"
+			"            if (!std::is_constant_evaluated()) {\n"
+			"                accumulateBlocked(C.values.data());\n"
+			"                return C;\n"
+			"            }\n"
+			"        }\n"
+			"        accumulatePanels(C.values.data());\n"
+			"        return C;\n"
+			"    }\n"
+			"    /* Every component of the product, from evaluate() where the product is matrix shaped and summed lazily otherwise. */\n"
+			"    constexpr auto materialize() const {\n"
+			"        if constexpr (matrixShaped) {\n"
+			"            return evaluate();\n"
+			"        } else {\n"
+			"            using value_type = std::remove_cvref_t<decltype(std::apply(*this, std::array<size_t, F> { }))>;\n"
+			"            DenseComponents<value_type, D, F> C { std::vector<value_type>(M * N) };\n"
+			"            std::array<size_t, F> indices = { };\n"
+			"            for (size_t q = 0; q < M * N; q++) {\n"
+			"                setDigits<D, 0, F>(indices, q);\n"
+			"                C.values[q] = std::apply(*this, indices);\n"
+			"            }\n"
+			"            return C;\n"
+			"        }\n"
+			"    }\n"
+			"    /*\n"
+			"     * Evaluates a product of more than two factors in the order of plan. Every step but the last is materialized into a\n"
+			"     * dense intermediate that the following steps read in place; the last one is returned relabeled to the free labels\n"
+			"     * of this product.\n"
+			"     */\n"
+			"    constexpr auto evaluatePlan() const {\n"
+			"        return runPlan<0>(std::tuple_cat(factorsOf(A), factorsOf(B)), std::tuple<> { });\n"
+			"    }\n"
+			"private:\n"
+			"    template<typename E>\n"
+			"    static constexpr auto factorsOf(E const& expression) {\n"
+			"        if constexpr (std::tuple_size_v<typename ProductFactors<E>::type> > 1) {\n"
+			"            return std::tuple_cat(factorsOf(expression.handle.A), factorsOf(expression.handle.B));\n"
+			"        } else {\n"
+			"            return std::tuple<E>(expression);\n"
+			"        }\n"
+			"    }\n"
+			"    template<typename V, typename T, size_t R, typename S, char...L>\n"
+			"    static constexpr auto viewOf(TensorExpression<T, D, R, S, L...> const&, V const* values) {\n"
+			"        return TensorExpression<DenseView<V, D, R>, D, R, Symmetries<R>, L...>(DenseView<V, D, R> { values });\n"
+			"    }\n"
+			"    template<typename V, typename T, typename S, char...L>\n"
+			"    static constexpr auto relabeled(TensorExpression<T, D, F, S, L...> const&, DenseComponents<V, D, F>&& C) {\n"
+			"        constexpr auto slots = [] {\n"
+			"            std::array<char, F> labels = { };\n"
+			"            std::copy(pattern.freeLabels.begin(), pattern.freeLabels.begin() + F, labels.begin());\n"
+			"            return labelPermutation<F>(labels, std::array<char, F> { L... });\n"
+			"        }();\n"
+			"        return [C = std::move(C), slots](auto...i) {\n"
+			"            std::array<size_t, F> const indices = { size_t(i)... };\n"
+			"            return std::apply(C, gatherIndices(indices, slots));\n"
+			"        };\n"
+			"    }\n"
+			"    template<size_t Step, typename Operands, typename Results>\n"
+			"    static constexpr auto runPlan(Operands const& operands, Results&& results) {\n"
+			"        auto const product = std::get<plan.steps[Step][0]>(operands) * std::get<plan.steps[Step][1]>(operands);\n"
+			"        auto C = product.handle.materialize();\n"
+			"        if constexpr (Step + 2 == factorCount) {\n"
+			"            return relabeled(product, std::move(C));\n"
+			"        } else {\n"
+			"            auto const view = viewOf(product, C.values.data());\n"
+			"            return runPlan<Step + 1>(std::tuple_cat(operands, std::make_tuple(view)), std::tuple_cat(std::move(results), std::make_tuple(std::move(C))));\n"
+			"        }\n"
+			"    }\n"
+			"    static constexpr bool denseA = IsDenseAccess<T1>::value;\n"
+			"    static constexpr bool denseB = IsDenseAccess<T2>::value;\n"
+			"    template<size_t R>\n"
+			"    static constexpr size_t denseOffset(std::array<size_t, F + NS> const& indices, std::array<size_t, R> const& slots) {\n"
+			"        size_t offset = 0;\n"
+			"        for (size_t r = 0; r < R; r++) {\n"
+			"            offset = D * offset + indices[slots[r]];\n"
+			"        }\n"
+			"        return offset;\n"
+			"    }\n"
+			"    /*\n"
+			"     * Calls f(m, k, value) for the components A(m, k), or B(k, m) with Lhs false, of rows [m0, m0 + mc) and columns\n"
+			"     * [k0, k0 + kc). Dense operands are read directly from their storage at precomputed row and column offsets, all\n"
+			"     * others through their accessor.\n"
+			"     */\n"
+			"    template<bool Lhs, typename Store>\n"
+			"    constexpr void gatherPanel(size_t m0, size_t mc, size_t k0, size_t kc, Store const& store) const {\n"
+			"        constexpr size_t first = Lhs ? 0 : FA;\n"
+			"        constexpr size_t count = Lhs ? FA : F - FA;\n"
+			"        auto const& operand = [this]() -> auto const& {\n"
+			"            if constexpr (Lhs) {\n"
+			"                return A;\n"
+			"            } else {\n"
+			"                return B;\n"
+			"            }\n"
+			"        }();\n"
+			"        constexpr auto const& slots = []() -> auto const& {\n"
+			"            if constexpr (Lhs) {\n"
+			"                return pattern.lhsSlots;\n"
+			"            } else {\n"
+			"                return pattern.rhsSlots;\n"
+			"            }\n"
+			"        }();\n"
+			"        std::array<size_t, F + NS> indices = { };\n"
+			"        if constexpr (Lhs ? denseA : denseB) {\n"
+			"            auto const* const data = denseData(operand.handle);\n"
+			"            std::vector<size_t> rows(mc);\n"
+			"            std::vector<size_t> columns(kc);\n"
+			"            for (size_t m = 0; m < mc; m++) {\n"
+			"                setDigits<D, first, count>(indices, m0 + m);\n"
+			"                rows[m] = denseOffset(indices, slots);\n"
+			"            }\n"
+			"            setDigits<D, first, count>(indices, 0);\n"
+			"            for (size_t k = 0; k < kc; k++) {\n"
+			"                setDigits<D, F, NS>(indices, k0 + k);\n"
+			"                columns[k] = denseOffset(indices, slots);\n"
+			"            }\n"
+			"            for (size_t m = 0; m < mc; m++) {\n"
+			"                for (size_t k = 0; k < kc; k++) {\n"
+			"                    store(m, k, data[rows[m] + columns[k]]);\n"
+			"                }\n"
+			"            }\n"
+			"        } else {\n"
+			"            for (size_t m = 0; m < mc; m++) {\n"
+			"                setDigits<D, first, count>(indices, m0 + m);\n"
+			"                for (size_t k = 0; k < kc; k++) {\n"
+			"                    setDigits<D, F, NS>(indices, k0 + k);\n"
+			"                    store(m, k, std::apply(operand, gatherIndices(indices, slots)));\n"
+			"                }\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    /*\n"
+			"     * Accumulates C panel by panel. Each panel of A and B is gathered once, so packed and symmetric operands are read\n"
+			"     * in their own layout only while packing and the inner loop runs over contiguous memory.\n"
+			"     */\n"
+			"    template<typename V>\n"
+			"    constexpr void accumulatePanels(V* C) const {\n"
+			"        using Tiles = ContractionTiles<V, M, N, K>;\n"
+			"        std::vector<V> a(Tiles::m * Tiles::k);\n"
+			"        std::vector<V> b(Tiles::k * Tiles::n);\n"
+			"        for (size_t n0 = 0; n0 < N; n0 += Tiles::n) {\n"
+			"            size_t const nc = std::min(Tiles::n, N - n0);\n"
+			"            for (size_t k0 = 0; k0 < K; k0 += Tiles::k) {\n"
+			"                size_t const kc = std::min(Tiles::k, K - k0);\n"
+			"                gatherPanel<false>(n0, nc, k0, kc, [&b, nc](size_t n, size_t k, auto const& value) {\n"
+			"                    b[k * nc + n] = value;\n"
+			"                });\n"
+			"                for (size_t m0 = 0; m0 < M; m0 += Tiles::m) {\n"
+			"                    size_t const mc = std::min(Tiles::m, M - m0);\n"
+			"                    gatherPanel<true>(m0, mc, k0, kc, [&a, kc](size_t m, size_t k, auto const& value) {\n"
+			"                        a[m * kc + k] = value;\n"
+			"                    });\n"
+			"                    for (size_t m = 0; m < mc; m++) {\n"
+			"                        V* const c = C + (m0 + m) * N + n0;\n"
+			"                        for (size_t k = 0; k < kc; k++) {\n"
+			"                            V const ak = a[m * kc + k];\n"
+			"                            V const* const bk = b.data() + k * nc;\n"
+			"                            for (size_t n = 0; n < nc; n++) {\n"
+			"                                c[n] += ak * bk[n];\n"
+			"                            }\n"
+			"                        }\n"
+			"                    }\n"
+			"                }\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    /*\n"
+			"     * Accumulates C with the GEMM loop nest around gemmMicroKernel: panels of A are packed into slivers of gemmRows rows\n"
+			"     * and panels of B into slivers of gemmColumns<V> columns, both k-major and zero padded to whole slivers.\n"
+			"     */\n"
+			"    template<typename V>\n"
+			"    void accumulateBlocked(V* C) const {\n"
+			"        using Tiles = GemmTiles<V, M, N, K>;\n"
+			"        constexpr size_t MR = gemmRows;\n"
+			"        constexpr size_t NR = gemmColumns<V>;\n"
+			"        constexpr size_t slivers = (Tiles::n + NR - 1) / NR;\n"
+			"        std::vector<V> a(((Tiles::m + MR - 1) / MR) * MR * Tiles::k);\n"
+			"        std::vector<V> b(slivers * NR * Tiles::k);\n"
+			"        for (size_t n0 = 0; n0 < N; n0 += Tiles::n) {\n"
+			"            size_t const nc = std::min(Tiles::n, N - n0);\n"
+			"            for (size_t k0 = 0; k0 < K; k0 += Tiles::k) {\n"
+			"                size_t const kc = std::min(Tiles::k, K - k0);\n"
+			"                std::fill(b.begin(), b.end(), V(0));\n"
+			"                gatherPanel<false>(n0, nc, k0, kc, [&b, kc](size_t n, size_t k, V const& value) {\n"
+			"                    b[((n / NR) * kc + k) * NR + n % NR] = value;\n"
+			"                });\n"
+			"                for (size_t m0 = 0; m0 < M; m0 += Tiles::m) {\n"
+			"                    size_t const mc = std::min(Tiles::m, M - m0);\n"
+			"                    std::fill(a.begin(), a.end(), V(0));\n"
+			"                    gatherPanel<true>(m0, mc, k0, kc, [&a, kc](size_t m, size_t k, V const& value) {\n"
+			"                        a[((m / MR) * kc + k) * MR + m % MR] = value;\n"
+			"                    });\n"
+			"                    for (size_t n = 0; n < nc; n += NR) {\n"
+			"                        for (size_t m = 0; m < mc; m += MR) {\n"
+			"                            gemmMicroKernel(kc, a.data() + m * kc, b.data() + n * kc, C + (m0 + m) * N + n0 + n, N, std::min(MR, mc - m), std::min(NR, nc - n));\n"
+			"                        }\n"
+			"                    }\n"
+			"                }\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"/* The callable an assignment reads from: tiled products are evaluated up front, everything else is used as is. */\n"
+			"template<typename T>\n"
+			"static constexpr T const& evaluated(T const& handle) {\n"
+			"    return handle;\n"
+			"}\n"
+			"\n"
+			"template<typename E1, typename E2>\n"
+			"static constexpr auto evaluated(Contraction<E1, E2> const& handle) {\n"
+			"    if constexpr (Contraction<E1, E2>::planned) {\n"
+			"        return handle.evaluatePlan();\n"
+			"    } else if constexpr (Contraction<E1, E2>::tiled) {\n"
+			"        return handle.evaluate();\n"
+			"    } else {\n"
+			"        return handle;\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"template<typename T1, typename T2, size_t D, size_t R1, size_t R2, typename S1, typename S2, char...I, char...J>\n"
+			"constexpr auto operator*(TensorExpression<T1, D, R1, S1, I...> const& A, TensorExpression<T2, D, R2, S2, J...> const& B) {\n"
+			"    using handle_type = Contraction<TensorExpression<T1, D, R1, S1, I...>, TensorExpression<T2, D, R2, S2, J...>>;\n"
+			"    constexpr auto const& pattern = handle_type::pattern;\n"
+			"    return [&A, &B]<size_t...K>(std::index_sequence<K...>) {\n"
+			"        return TensorExpression<handle_type, D, handle_type::F, Symmetries<handle_type::F>, pattern.freeLabels[K]...>(handle_type { A, B });\n"
+			"    }(std::make_index_sequence<handle_type::F>());\n"
+			"}\n"
+			"\n"
+			"template<typename>\n"
+			"struct ProductPlan;\n"
+			"\n"
+			"template<typename E1, typename E2, size_t D, size_t F, typename S, char...L>\n"
+			"struct ProductPlan<TensorExpression<Contraction<E1, E2>, D, F, S, L...>> {\n"
+			"    static constexpr auto const& value = Contraction<E1, E2>::plan;\n"
+			"};\n"
+			"\n"
+			"/* The evaluation order and flop count chosen for the product expression type E. */\n"
+			"template<typename E>\n"
+			"static constexpr auto const& contractionPlanOf = ProductPlan<std::remove_cvref_t<E>>::value;\n";
+	code.stringToFile(codeString);
+}
+
+void elementwiseImplementation(CodeGen &code) {
+	const char *codeString =
+			"template<typename>\n"
+			"struct IsTensorExpression: std::false_type {\n"
+			"};\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, typename S, char...I>\n"
+			"struct IsTensorExpression<TensorExpression<T, D, R, S, I...>> : std::true_type {\n"
+			"};\n"
+			"\n"
+			"template<typename U>\n"
+			"concept Scalar = !IsTensorExpression<std::decay_t<U>>::value;\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, char...I>\n"
+			"static constexpr auto makeExpression(T&& f) {\n"
+			"    return TensorExpression<std::decay_t<T>, D, R, Symmetries<R>, I...>(std::forward<T>(f));\n"
+			"}\n"
+			"\n"
+			"template<typename Op, typename T1, typename T2, size_t D, size_t R, typename S1, typename S2, char...I, char...J>\n"
+			"static constexpr auto elementwise(TensorExpression<T1, D, R, S1, I...> const& A, TensorExpression<T2, D, R, S2, J...> const& B) {\n"
+			"    constexpr auto const& slots = LabelsOf<R, I...>::template slots<J...>;\n"
+			"    auto f = [A, B](auto...i) {\n"
+			"        std::array<size_t, R> const indices = { size_t(i)... };\n"
+			"        return Op { }(A(i...), std::apply(B, gatherIndices(indices, slots)));\n"
+			"    };\n"
+			"    return makeExpression<decltype(f), D, R, I...>(std::move(f));\n"
+			"}\n"
+			"\n"
+			"template<typename T1, typename T2, size_t D, size_t R, typename S1, typename S2, char...I, char...J>\n"
+			"constexpr auto operator+(TensorExpression<T1, D, R, S1, I...> const& A, TensorExpression<T2, D, R, S2, J...> const& B) {\n"
+			"    return elementwise<std::plus<>>(A, B);\n"
+			"}\n"
+			"\n"
+			"template<typename T1, typename T2, size_t D, size_t R, typename S1, typename S2, char...I, char...J>\n"
+			"constexpr auto operator-(TensorExpression<T1, D, R, S1, I...> const& A, TensorExpression<T2, D, R, S2, J...> const& B) {\n"
+			"    return elementwise<std::minus<>>(A, B);\n"
+			"}\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, typename S, char...I>\n"
+			"constexpr auto operator-(TensorExpression<T, D, R, S, I...> const& A) {\n"
+			"    auto f = [A](auto...i) {\n"
+			"        return -A(i...);\n"
+			"    };\n"
+			"    return makeExpression<decltype(f), D, R, I...>(std::move(f));\n"
+			"}\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, typename S, char...I>\n"
+			"constexpr auto operator+(TensorExpression<T, D, R, S, I...> const& A) {\n"
+			"    return A;\n"
+			"}\n"
+			"\n"
+			"template<Scalar U, typename T, size_t D, size_t R, typename S, char...I>\n"
+			"constexpr auto operator*(U const& a, TensorExpression<T, D, R, S, I...> const& A) {\n"
+			"    auto f = [a, A](auto...i) {\n"
+			"        return a * A(i...);\n"
+			"    };\n"
+			"    return makeExpression<decltype(f), D, R, I...>(std::move(f));\n"
+			"}\n"
+			"\n"
+			"template<Scalar U, typename T, size_t D, size_t R, typename S, char...I>\n"
+			"constexpr auto operator*(TensorExpression<T, D, R, S, I...> const& A, U const& a) {\n"
+			"    auto f = [a, A](auto...i) {\n"
+			"        return A(i...) * a;\n"
+			"    };\n"
+			"    return makeExpression<decltype(f), D, R, I...>(std::move(f));\n"
+			"}\n"
+			"\n"
+			"template<Scalar U, typename T, size_t D, size_t R, typename S, char...I>\n"
+			"constexpr auto operator/(TensorExpression<T, D, R, S, I...> const& A, U const& a) {\n"
+			"    auto f = [a, A](auto...i) {\n"
+			"        return A(i...) / a;\n"
+			"    };\n"
+			"    return makeExpression<decltype(f), D, R, I...>(std::move(f));\n"
+			"}\n";
+	code.stringToFile(codeString);
+}
+
+void batchImplementation(CodeGen &code) {
+	const char *codeString =
+			"#if __has_include(<experimental/simd>)\n"
+			"\n"
+			"template<typename T, size_t W>\n"
+			"using Lanes = std::experimental::fixed_size_simd<T, W>;\n"
+			"\n"
+			"template<typename T>\n"
+			"static constexpr size_t nativeLaneCount = std::experimental::native_simd<T>::size();\n"
+			"\n"
+			"#else\n"
+			"\n"
+			"template<typename T, size_t W>\n"
+			"struct Lanes {\n"
+			"    using value_type = T;\n"
+			"    constexpr Lanes() = default;\n"
+			"    constexpr Lanes(T const& value) {\n"
+			"        v.fill(value);\n"
+			"    }\n"
+			"    static constexpr size_t size() {\n"
+			"        return W;\n"
+			"    }\n"
+			"    constexpr T& operator[](size_t lane) {\n"
+			"        return v[lane];\n"
+			"    }\n"
+			"    constexpr T const& operator[](size_t lane) const {\n"
+			"        return v[lane];\n"
+			"    }\n"
+			"    constexpr Lanes operator-() const {\n"
+			"        Lanes result;\n"
+			"        for (size_t w = 0; w < W; w++) {\n"
+			"            result.v[w] = -v[w];\n"
+			"        }\n"
+			"        return result;\n"
+			"    }\n"
+			"    constexpr Lanes& operator+=(Lanes const& other) {\n"
+			"        for (size_t w = 0; w < W; w++) {\n"
+			"            v[w] += other.v[w];\n"
+			"        }\n"
+			"        return *this;\n"
+			"    }\n"
+			"    constexpr Lanes& operator-=(Lanes const& other) {\n"
+			"        for (size_t w = 0; w < W; w++) {\n"
+			"            v[w] -= other.v[w];\n"
+			"        }\n"
+			"        return *this;\n"
+			"    }\n"
+			"    constexpr Lanes& operator*=(Lanes const& other) {\n"
+			"        for (size_t w = 0; w < W; w++) {\n"
+			"            v[w] *= other.v[w];\n"
+			"        }\n"
+			"        return *this;\n"
+			"    }\n"
+			"    constexpr Lanes& operator/=(Lanes const& other) {\n"
+			"        for (size_t w = 0; w < W; w++) {\n"
+			"            v[w] /= other.v[w];\n"
+			"        }\n"
+			"        return *this;\n"
+			"    }\n"
+			"    friend constexpr Lanes operator+(Lanes a, Lanes const& b) {\n"
+			"        return a += b;\n"
+			"    }\n"
+			"    friend constexpr Lanes operator-(Lanes a, Lanes const& b) {\n"
+			"        return a -= b;\n"
+			"    }\n"
+			"    friend constexpr Lanes operator*(Lanes a, Lanes const& b) {\n"
+			"        return a *= b;\n"
+			"    }\n"
+			"    friend constexpr Lanes operator/(Lanes a, Lanes const& b) {\n"
+			"        return a /= b;\n"
+			"    }\n"
+			"private:\n"
+			"    alignas(sizeof(T) * W) std::array<T, W> v;\n"
+			"};\n"
+			"\n"
+			"template<typename T>\n"
+			"static constexpr size_t nativeLaneCount = 32 / sizeof(T);\n"
+			"\n"
+			"#endif\n"
+			"\n"
+			"template<typename T, size_t W, size_t D, size_t R, auto...S>\n"
+			"using TensorBatch = Tensor<Lanes<T, W>, D, R, S...>;\n"
+			"\n"
+			"/* The scalar of a component type, which for a batch is the value type of its lanes. */\n"
+			"template<typename T>\n"
+			"struct LaneValue {\n"
+			"    using type = T;\n"
+			"};\n"
+			"\n"
+			"template<typename T>\n"
+			"requires requires {\n"
+			"    typename T::value_type;\n"
+			"}\n"
+			"struct LaneValue<T> {\n"
+			"    using type = typename T::value_type;\n"
+			"};\n"
+			"\n"
+			"template<typename T>\n"
+			"using lane_value_type = typename LaneValue<T>::type;\n"
+			"\n"
+			"template<typename B, typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr void insertLane(Tensor<B, D, R, S...>& batch, size_t lane, Tensor<T, D, R, S...> const& tensor) {\n"
+			"    for (size_t k = 0; k < tensor.size(); k++) {\n"
+			"        batch.data()[k][lane] = tensor.data()[k];\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"template<typename B, size_t D, size_t R, auto...S>\n"
+			"constexpr auto extractLane(Tensor<B, D, R, S...> const& batch, size_t lane) {\n"
+			"    Tensor<typename B::value_type, D, R, S...> tensor;\n"
+			"    for (size_t k = 0; k < tensor.size(); k++) {\n"
+			"        tensor.data()[k] = batch.data()[k][lane];\n"
+			"    }\n"
+			"    return tensor;\n"
+			"}\n"
+			"\n"
+			"template<typename B, typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr void loadBatch(Tensor<B, D, R, S...>& batch, Tensor<T, D, R, S...> const* tensors) {\n"
+			"    for (size_t lane = 0; lane < B::size(); lane++) {\n"
+			"        insertLane(batch, lane, tensors[lane]);\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"template<typename B, typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr void storeBatch(Tensor<B, D, R, S...> const& batch, Tensor<T, D, R, S...>* tensors) {\n"
+			"    for (size_t lane = 0; lane < B::size(); lane++) {\n"
+			"        tensors[lane] = extractLane(batch, lane);\n"
+			"    }\n"
+			"}\n";
+	code.stringToFile(codeString);
+}
+
+void parallelImplementation(CodeGen &code) {
+	const char *codeString =
+			"struct SequentialPolicy {\n"
+			"};\n"
+			"\n"
+			"struct ParallelPolicy {\n"
+			"};\n"
+			"\n"
+			"inline constexpr SequentialPolicy seq { };\n"
+			"inline constexpr ParallelPolicy par { };\n"
+			"\n"
+			"static constexpr size_t cacheLineSize = 64;\n"
+			"static constexpr size_t parallelThreshold = size_t(1) << 15;\n"
+			"static constexpr size_t parallelGrain = size_t(1) << 12;\n"
+			"\n"
+			"/* Only storage large enough for forEachUnique(par) is padded to cache lines; small tensors keep their natural size. */\n"
+			"template<typename T, size_t N>\n"
+			"static constexpr size_t storageAlignment = std::max(alignof(std::array<T, N>), (N >= parallelThreshold) ? cacheLineSize : size_t(1));\n"
+			"\n"
+			"/*\n"
+			" * Fixed pool of hardware_concurrency() - 1 workers plus the calling thread, with one deque of index ranges per thread.\n"
+			" * parallelRange starts every thread on its own contiguous share of the range, always the same share for the same count\n"
+			" * and grain, so memory first touched through one parallelRange stays local to the thread that later works on it. A\n"
+			" * thread splits the upper half of its range onto its deque whenever the deque has run empty and works through the\n"
+			" * lower half in grains; idle threads steal the oldest, largest range from the front of another deque. One\n"
+			" * parallelRange runs at a time; calls made from inside a running task execute sequentially on the calling thread.\n"
+			" */\n"
+			"class ThreadPool {\n"
+			"public:\n"
+			"    explicit ThreadPool(size_t threadCount) :\n"
+			"            queues(threadCount) {\n"
+			"        for (size_t n = 1; n < threadCount; n++) {\n"
+			"            workers.emplace_back([this, n]() {\n"
+			"                workerLoop(n);\n"
+			"            });\n"
+			"        }\n"
+			"    }\n"
+			"    ~ThreadPool() {\n"
+			"        {\n"
+			"            std::lock_guard<std::mutex> lock(mutex);\n"
+			"            stopping = true;\n"
+			"        }\n"
+			"        wake.notify_all();\n"
+			"        for (auto& worker : workers) {\n"
+			"            worker.join();\n"
+			"        }\n"
+			"    }\n"
+			"    static ThreadPool& instance() {\n"
+			"        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));\n"
+			"        return pool;\n"
+			"    }\n"
+			"    size_t size() const {\n"
+			"        return workers.size() + 1;\n"
+			"    }\n"
+			"    /* Calls f(begin, end) on disjoint ranges that cover [0, count) and begin at multiples of grain. */\n"
+			"    template<typename F>\n"
+			"    void parallelRange(size_t count, size_t grain, F const& f) {\n"
+			"        grain = std::max(size_t(1), grain);\n"
+			"        if (workers.empty() || (count <= grain) || insideTask()) {\n"
+			"            if (count) {\n"
+			"                f(size_t(0), count);\n"
+			"            }\n"
+			"            return;\n"
+			"        }\n"
+			"        std::lock_guard<std::mutex> serial(submitMutex);\n"
+			"        Job const job { [](void const* data, size_t begin, size_t end) {\n"
+			"            (*static_cast<F const*>(data))(begin, end);\n"
+			"        }, &f, grain };\n"
+			"        size_t const grains = (count + grain - 1) / grain;\n"
+			"        for (size_t t = 0; t < queues.size(); t++) {\n"
+			"            size_t const begin = std::min(count, grains * t / queues.size() * grain);\n"
+			"            size_t const end = std::min(count, grains * (t + 1) / queues.size() * grain);\n"
+			"            if (begin < end) {\n"
+			"                queues[t].ranges.push_back( { begin, end });\n"
+			"            }\n"
+			"        }\n"
+			"        {\n"
+			"            std::lock_guard<std::mutex> lock(mutex);\n"
+			"            current = job;\n"
+			"            remaining = count;\n"
+			"            finishedWorkers = 0;\n"
+			"            generation++;\n"
+			"        }\n"
+			"        wake.notify_all();\n"
+			"        insideTask() = true;\n"
+			"        run(0, job);\n"
+			"        insideTask() = false;\n"
+			"        std::unique_lock<std::mutex> lock(mutex);\n"
+			"        idle.wait(lock, [this]() {\n"
+			"            return finishedWorkers == workers.size();\n"
+			"        });\n"
+			"    }\n"
+			"private:\n"
+			"    struct Job {\n"
+			"        void (*invoke)(void const*, size_t, size_t);\n"
+			"        void const* data;\n"
+			"        size_t grain;\n"
+			"    };\n"
+			"    struct Range {\n"
+			"        size_t begin;\n"
+			"        size_t end;\n"
+			"    };\n"
+			"    struct alignas(cacheLineSize) Queue {\n"
+			"        std::mutex mutex;\n"
+			"        std::deque<Range> ranges;\n"
+			"    };\n"
+			"    static bool& insideTask() {\n"
+			"        static thread_local bool inside = false;\n"
+			"        return inside;\n"
+			"    }\n"
+			"    bool pop(size_t t, Range& range) {\n"
+			"        std::lock_guard<std::mutex> lock(queues[t].mutex);\n"
+			"        if (queues[t].ranges.empty()) {\n"
+			"            return false;\n"
+			"        }\n"
+			"        range = queues[t].ranges.back();\n"
+			"        queues[t].ranges.pop_back();\n"
+			"        return true;\n"
+			"    }\n"
+			"    bool steal(size_t t, Range& range) {\n"
+			"        for (size_t v = 1; v < queues.size(); v++) {\n"
+			"            Queue& victim = queues[(t + v) % queues.size()];\n"
+			"            std::lock_guard<std::mutex> lock(victim.mutex);\n"
+			"            if (!victim.ranges.empty()) {\n"
+			"                range = victim.ranges.front();\n"
+			"                victim.ranges.pop_front();\n"
+			"                return true;\n"
+			"            }\n"
+			"        }\n"
+			"        return false;\n"
+			"    }\n"
+			"    bool split(size_t t, Range& range, size_t grain) {\n"
+			"        std::lock_guard<std::mutex> lock(queues[t].mutex);\n"
+			"        if (!queues[t].ranges.empty()) {\n"
+			"            return false;\n"
+			"        }\n"
+			"        size_t const middle = (range.begin / grain + (range.end - range.begin + grain - 1) / grain / 2) * grain;\n"
+			"        queues[t].ranges.push_back( { middle, range.end });\n"
+			"        range.end = middle;\n"
+			"        return true;\n"
+			"    }\n"
+			"    void run(size_t t, Job const& job) {\n"
+			"        Range range;\n"
+			"        while (remaining.load(std::memory_order_acquire)) {\n"
+			"            if (!pop(t, range) && !steal(t, range)) {\n"
+			"                std::this_thread::yield();\n"
+			"                continue;\n"
+			"            }\n"
+			"            while (range.begin < range.end) {\n"
+			"                if (range.end - range.begin > 2 * job.grain) {\n"
+			"                    split(t, range, job.grain);\n"
+			"                }\n"
+			"                size_t const end = std::min(range.end, (range.begin / job.grain + 1) * job.grain);\n"
+			"                job.invoke(job.data, range.begin, end);\n"
+			"                remaining.fetch_sub(end - range.begin, std::memory_order_release);\n"
+			"                range.begin = end;\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    void workerLoop(size_t t) {\n"
+			"        insideTask() = true;\n"
+			"        size_t seen = 0;\n"
+			"        std::unique_lock<std::mutex> lock(mutex);\n"
+			"        while (true) {\n"
+			"            wake.wait(lock, [this, seen]() {\n"
+			"                return stopping || (generation != seen);\n"
+			"            });\n"
+			"            if (stopping) {\n"
+			"                return;\n"
+			"            }\n"
+			"            seen = generation;\n"
+			"            Job const job = current;\n"
+			"            lock.unlock();\n"
+			"            run(t, job);\n"
+			"            lock.lock();\n"
+			"            if (++finishedWorkers == workers.size()) {\n"
+			"                idle.notify_all();\n"
+			"            }\n"
+			"        }\n"
+			"    }\n"
+			"    std::vector<Queue> queues;\n"
+			"    std::vector<std::thread> workers;\n"
+			"    std::mutex submitMutex;\n"
+			"    std::mutex mutex;\n"
+			"    std::condition_variable wake;\n"
+			"    std::condition_variable idle;\n"
+			"    Job current { };\n"
+			"    std::atomic<size_t> remaining { 0 };\n"
+			"    size_t generation = 0;\n"
+			"    size_t finishedWorkers = 0;\n"
+			"    bool stopping = false;\n"
+			"};\n"
+			"\n"
+			"template<size_t D, typename S, size_t ElementSize, typename F>\n"
+			"constexpr void forEachUnique(SequentialPolicy, F const& f) {\n"
+			"    for (auto const& indices : UniqueTuples<D, S> { }) {\n"
+			"        f(indices);\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"/*\n"
+			" * Splits the unique tuples into grains of whole cache lines of the packed output, so two threads never write the same\n"
+			" * line, and hands them to the thread pool. Every component is computed by exactly the same expression as in the\n"
+			" * sequential loop, so the result does not depend on the schedule. Tensors below parallelThreshold stay sequential.\n"
+			" */\n"
+			"template<size_t D, typename S, size_t ElementSize, typename F>\n"
+			"constexpr void forEachUnique(ParallelPolicy, F const& f) {\n"
+			"    constexpr size_t count = packedSizeOf<D, S>;\n"
+			"    if constexpr (count < parallelThreshold) {\n"
+			"        forEachUnique<D, S, ElementSize>(seq, f);\n"
+			"    } else {\n"
+			"        if (std::is_constant_evaluated()) {\n"
+			"            forEachUnique<D, S, ElementSize>(seq, f);\n"
+			"            return;\n"
+			"        }\n"
+			"        constexpr size_t lineElements = std::max(size_t(1), cacheLineSize / ElementSize);\n"
+			"        constexpr size_t grain = (parallelGrain + lineElements - 1) / lineElements * lineElements;\n"
+			"        ThreadPool::instance().parallelRange(count, grain, [&f](size_t begin, size_t end) {\n"
+			"            auto it = UniqueTuples<D, S> { }.at(begin);\n"
+			"            for (size_t k = begin; k < end; k++, ++it) {\n"
+			"                f(*it);\n"
+			"            }\n"
+			"        });\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"template<typename F>\n"
+			"void forEachIndex(SequentialPolicy, size_t count, F const& f) {\n"
+			"    for (size_t n = 0; n < count; n++) {\n"
+			"        f(n);\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"/*\n"
+			" * f(n) for every n in [0, count), typically one small expression per cell or particle on tensors of any type. The grain\n"
+			" * leaves every thread enough ranges to steal from when the cost of f varies between indices.\n"
+			" */\n"
+			"template<typename F>\n"
+			"void forEachIndex(ParallelPolicy, size_t count, F const& f) {\n"
+			"    ThreadPool& pool = ThreadPool::instance();\n"
+			"    size_t const grain = std::clamp(count / (64 * pool.size()), size_t(1), parallelGrain);\n"
+			"    pool.parallelRange(count, grain, [&f](size_t begin, size_t end) {\n"
+			"        for (size_t n = begin; n < end; n++) {\n"
+			"            f(n);\n"
+			"        }\n"
+			"    });\n"
+			"}\n";
+	code.stringToFile(codeString);
+}
+
+void gemmImplementation(CodeGen &code) {
+	const char *codeString =
+			"static constexpr size_t l1CacheSize = size_t(1) << 15;\n"
+			"static constexpr size_t l2CacheSize = size_t(1) << 18;\n"
+			"\n"
+			"#if __has_include(<experimental/simd>)\n"
+			"\n"
+			"template<size_t W, typename T>\n"
+			"static inline Lanes<T, W> loadLanes(T const* source) {\n"
+			"    return Lanes<T, W>(source, std::experimental::element_aligned);\n"
+			"}\n"
+			"\n"
+			"template<typename L, typename T>\n"
+			"static inline void storeLanes(L const& lanes, T* destination) {\n"
+			"    lanes.copy_to(destination, std::experimental::element_aligned);\n"
+			"}\n"
+			"\n"
+			"#else\n"
+			"\n"
+			"template<size_t W, typename T>\n"
+			"static inline Lanes<T, W> loadLanes(T const* source) {\n"
+			"    Lanes<T, W> lanes;\n"
+			"    for (size_t w = 0; w < W; w++) {\n"
+			"        lanes[w] = source[w];\n"
+			"    }\n"
+			"    return lanes;\n"
+			"}\n"
+			"\n"
+			"template<typename L, typename T>\n"
+			"static inline void storeLanes(L const& lanes, T* destination) {\n"
+			"    for (size_t w = 0; w < L::size(); w++) {\n"
+			"        destination[w] = lanes[w];\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"#endif\n"
+			"\n"
+			"/*\n"
+			" * Register block of the micro-kernel: gemmRows x gemmColumns<T> accumulators, two native vectors per row, which with one\n"
+			" * broadcast and two loads fills the 16 vector registers of SSE and AVX.\n"
+			" */\n"
+			"static constexpr size_t gemmRows = 6;\n"
+			"\n"
+			"template<typename T>\n"
+			"static constexpr size_t gemmColumns = 2 * nativeLaneCount<T>;\n"
+			"\n"
+			"/*\n"
+			" * Cache blocking of C(M x N) += A(M x K) * B(K x N): a row sliver of A and a column sliver of B share L1, the packed A\n"
+			" * panel fills half of L2 and the packed B panel four times L2.\n"
+			" */\n"
+			"template<typename T, size_t M, size_t N, size_t K>\n"
+			"struct GemmTiles {\n"
+			"    static constexpr size_t k = std::clamp(l1CacheSize / ((gemmRows + gemmColumns<T>) * sizeof(T)), size_t(1), K);\n"
+			"    static constexpr size_t m = std::min(std::max(l2CacheSize / (2 * k * sizeof(T)) / gemmRows * gemmRows, gemmRows), M);\n"
+			"    static constexpr size_t n = std::min(std::max(4 * l2CacheSize / (k * sizeof(T)) / gemmColumns<T> * gemmColumns<T>, gemmColumns<T>), N);\n"
+			"};\n"
+			"\n"
+			"/*\n"
+			" * C[mr x nr] += a * b over kc steps, where a is a packed sliver of gemmRows values per step and b one of gemmColumns<T>\n"
+			" * values per step, both zero padded. C has row stride ldc; mr and nr are below the block size only at the edges. The\n"
+			" * rows are unrolled by a fold so that the accumulators stay in registers.\n"
+			" */\n"
+			"template<typename T>\n"
+			"static void gemmMicroKernel(size_t kc, T const* a, T const* b, T* c, size_t ldc, size_t mr, size_t nr) {\n"
+			"    constexpr size_t W = nativeLaneCount<T>;\n"
+			"    constexpr size_t MR = gemmRows;\n"
+			"    constexpr size_t NR = gemmColumns<T>;\n"
+			"    [&]<size_t...R>(std::index_sequence<R...>) {\n"
+			"        std::array<Lanes<T, W>, MR> c0;\n"
+			"        std::array<Lanes<T, W>, MR> c1;\n"
+			"        ((c0[R] = Lanes<T, W>(T(0)), c1[R] = Lanes<T, W>(T(0))), ...);\n"
+			"        for (size_t k = 0; k < kc; k++) {\n"
+			"            Lanes<T, W> const b0 = loadLanes<W>(b + k * NR);\n"
+			"            Lanes<T, W> const b1 = loadLanes<W>(b + k * NR + W);\n"
+			"            ((c0[R] += Lanes<T, W>(a[k * MR + R]) * b0, c1[R] += Lanes<T, W>(a[k * MR + R]) * b1), ...);\n"
+			"        }\n"
+			"        if (mr == MR && nr == NR) {\n"
+			"            ((storeLanes(loadLanes<W>(c + R * ldc) + c0[R], c + R * ldc), storeLanes(loadLanes<W>(c + R * ldc + W) + c1[R], c + R * ldc + W)), ...);\n"
+			"        } else {\n"
+			"            std::array<T, MR * NR> block;\n"
+			"            ((storeLanes(c0[R], block.data() + R * NR), storeLanes(c1[R], block.data() + R * NR + W)), ...);\n"
+			"            for (size_t r = 0; r < mr; r++) {\n"
+			"                for (size_t n = 0; n < nr; n++) {\n"
+			"                    c[r * ldc + n] += block[r * NR + n];\n"
+			"                }\n"
+			"            }\n"
+			"        }\n"
+			"    }(std::make_index_sequence<MR>());\n"
+			"}\n";
+	code.stringToFile(codeString);
+}
+
+void reductionImplementation(CodeGen &code) {
+	const char *codeString =
+			"/*\n"
+			" * A stored component of a tensor and the index tuples that share it: multiplicity counts the tuples with a nonzero\n"
+			" * sign, signedMultiplicity sums their signs. indices is the canonical tuple, whose sign is +1.\n"
+			" */\n"
+			"template<size_t R>\n"
+			"struct UniqueComponent {\n"
+			"    std::array<size_t, R> indices;\n"
+			"    size_t multiplicity;\n"
+			"    std::ptrdiff_t signedMultiplicity;\n"
+			"};\n"
+			"\n"
+			"/*\n"
+			" * The unique components of symmetry S in packed storage order. Closed-form symmetries count each block in closed form,\n"
+			" * k! / (n_1! n_2! ...) tuples for a symmetric block with repeated values n_v and k! for an antisymmetric block whose\n"
+			" * signs cancel; other groups tally the full index table.\n"
+			" */\n"
+			"template<size_t D, typename S>\n"
+			"static constexpr auto uniqueComponentsOf = []() {\n"
+			"    constexpr size_t R = S::Rank;\n"
+			"    constexpr auto const& blocks = S::blocks;\n"
+			"    std::array<UniqueComponent<R>, packedSizeOf<D, S>> components = { };\n"
+			"    size_t k = 0;\n"
+			"    for (auto const& indices : UniqueTuples<D, S> { }) {\n"
+			"        components[k].indices = indices;\n"
+			"        components[k].multiplicity = 1;\n"
+			"        components[k].signedMultiplicity = 1;\n"
+			"        k++;\n"
+			"    }\n"
+			"    if constexpr (blocks.closedForm) {\n"
+			"        for (auto& component : components) {\n"
+			"            for (size_t b = 0; b < blocks.count; b++) {\n"
+			"                size_t const size = blocks.sizes[b];\n"
+			"                size_t const* const slots = blocks.slots.data() + blocks.offsets[b];\n"
+			"                size_t count = 1;\n"
+			"                size_t run = 1;\n"
+			"                for (size_t m = 1; m < size; m++) {\n"
+			"                    run = (component.indices[slots[m]] == component.indices[slots[m - 1]]) ? run + 1 : 1;\n"
+			"                    count = count * (m + 1) / run;\n"
+			"                }\n"
+			"                component.multiplicity *= count;\n"
+			"                component.signedMultiplicity *= (blocks.signs[b] > 0 || size < 2) ? std::ptrdiff_t(count) : 0;\n"
+			"            }\n"
+			"        }\n"
+			"    } else {\n"
+			"        for (auto& component : components) {\n"
+			"            component.multiplicity = 0;\n"
+			"            component.signedMultiplicity = 0;\n"
+			"        }\n"
+			"        for (auto const entry : packedTableOf<D, S>) {\n"
+			"            int const sign = int(entry & 3) - 1;\n"
+			"            components[entry >> 2].multiplicity += (sign != 0);\n"
+			"            components[entry >> 2].signedMultiplicity += sign;\n"
+			"        }\n"
+			"    }\n"
+			"    return components;\n"
+			"}();\n"
+			"\n"
+			"/*\n"
+			" * Full reductions over all D^R components that visit each stored component once, weighted by its multiplicity. Both\n"
+			" * operands of dot share one symmetry, so the signs of their components cancel.\n"
+			" */\n"
+			"template<typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr T dot(Tensor<T, D, R, S...> const& A, Tensor<T, D, R, S...> const& B) {\n"
+			"    T result = T(0);\n"
+			"    if constexpr (sizeof...(S)) {\n"
+			"        constexpr auto const& components = uniqueComponentsOf<D, Symmetries<R, S...>>;\n"
+			"        for (size_t k = 0; k < components.size(); k++) {\n"
+			"            result += T(lane_value_type<T>(components[k].multiplicity)) * A.data()[k] * B.data()[k];\n"
+			"        }\n"
+			"    } else {\n"
+			"        for (size_t k = 0; k < A.size(); k++) {\n"
+			"            result += A.data()[k] * B.data()[k];\n"
+			"        }\n"
+			"    }\n"
+			"    return result;\n"
+			"}\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr T norm(Tensor<T, D, R, S...> const& A) {\n"
+			"    using std::sqrt;\n"
+			"    return sqrt(dot(A, A));\n"
+			"}\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr T sum(Tensor<T, D, R, S...> const& A) {\n"
+			"    T result = T(0);\n"
+			"    if constexpr (sizeof...(S)) {\n"
+			"        constexpr auto const& components = uniqueComponentsOf<D, Symmetries<R, S...>>;\n"
+			"        for (size_t k = 0; k < components.size(); k++) {\n"
+			"            result += T(lane_value_type<T>(components[k].signedMultiplicity)) * A.data()[k];\n"
+			"        }\n"
+			"    } else {\n"
+			"        for (size_t k = 0; k < A.size(); k++) {\n"
+			"            result += A.data()[k];\n"
+			"        }\n"
+			"    }\n"
+			"    return result;\n"
+			"}\n"
+			"\n"
+			"template<typename T, size_t D, size_t R, auto...S>\n"
+			"constexpr T maxAbs(Tensor<T, D, R, S...> const& A) {\n"
+			"    using std::abs;\n"
+			"    T result = T(0);\n"
+			"    for (size_t k = 0; k < A.size(); k++) {\n"
+			"        result = std::max(result, T(abs(A.data()[k])));\n"
+			"    }\n"
+			"    return result;\n"
+			"}\n";
+	code.stringToFile(codeString);
+}
+
+void fieldImplementation(CodeGen &code) {
+	const char *codeString =
+			"/* Allocator of cache line aligned storage that default-initializes, so pages are touched first by whoever fills them. */\n"
+			"template<typename T>\n"
+			"struct AlignedAllocator {\n"
+			"    using value_type = T;\n"
+			"    AlignedAllocator() = default;\n"
+			"    template<typename U>\n"
+			"    constexpr AlignedAllocator(AlignedAllocator<U> const&) {\n"
+			"    }\n"
+			"    T* allocate(size_t count) {\n"
+			"        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(cacheLineSize)));\n"
+			"    }\n"
+			"    void deallocate(T* pointer, size_t count) {\n"
+			"        ::operator delete(pointer, count * sizeof(T), std::align_val_t(cacheLineSize));\n"
+			"    }\n"
+			"    template<typename U, typename...Args>\n"
+			"    void construct(U* pointer, Args&&...args) {\n"
+			"        if constexpr (sizeof...(Args)) {\n"
+			"            ::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);\n"
+			"        } else {\n"
+			"            ::new (static_cast<void*>(pointer)) U;\n"
+			"        }\n"
+			"    }\n"
+			"    friend bool operator==(AlignedAllocator const&, AlignedAllocator const&) {\n"
+			"        return true;\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"/*\n"
+			" * One tensor per cell in structure-of-arrays layout: each packed component is a contiguous, cache line aligned array\n"
+			" * over the cells, padded to whole cache lines and whole batches. Cell n is the strided view operator[](n), batches of\n"
+			" * lanes cells starting at a multiple of lanes move to and from TensorBatch with one vector load or store per component.\n"
+			" * With the parallel policy the components are zeroed by the threads that evaluateField(par, ...) assigns the same cells\n"
+			" * to, so that on NUMA systems the pages of each share lie on the node of its thread.\n"
+			" */\n"
+			"template<typename T, size_t D, size_t R, auto...S>\n"
+			"class TensorField {\n"
+			"public:\n"
+			"    static constexpr size_t lanes = nativeLaneCount<T>;\n"
+			"    static constexpr size_t componentCount = packedSizeOf<D, Symmetries<R, S...>>;\n"
+			"    static constexpr size_t blockSize = std::lcm(lanes, std::max(size_t(1), cacheLineSize / sizeof(T)));\n"
+			"    static constexpr size_t blockGrain = std::max(size_t(1), parallelGrain / blockSize);\n"
+			"    using batch_type = TensorBatch<T, lanes, D, R, S...>;\n"
+			"    explicit TensorField(size_t cellCount) :\n"
+			"            TensorField(seq, cellCount) {\n"
+			"    }\n"
+			"    TensorField(SequentialPolicy, size_t cellCount) :\n"
+			"            cells(cellCount), pitch(paddedCount(cellCount)), values(componentCount * pitch) {\n"
+			"        std::fill(values.begin(), values.end(), T(0));\n"
+			"    }\n"
+			"    TensorField(ParallelPolicy, size_t cellCount) :\n"
+			"            cells(cellCount), pitch(paddedCount(cellCount)), values(componentCount * pitch) {\n"
+			"        ThreadPool::instance().parallelRange(blocks(), blockGrain, [this](size_t begin, size_t end) {\n"
+			"            for (size_t k = 0; k < componentCount; k++) {\n"
+			"                std::fill(component(k) + begin * blockSize, component(k) + end * blockSize, T(0));\n"
+			"            }\n"
+			"        });\n"
+			"    }\n"
+			"    size_t size() const {\n"
+			"        return cells;\n"
+			"    }\n"
+			"    size_t blocks() const {\n"
+			"        return pitch / blockSize;\n"
+			"    }\n"
+			"    T* component(size_t k) {\n"
+			"        return values.data() + k * pitch;\n"
+			"    }\n"
+			"    T const* component(size_t k) const {\n"
+			"        return values.data() + k * pitch;\n"
+			"    }\n"
+			"    TensorView<T, D, R, S...> operator[](size_t n) {\n"
+			"        return TensorView<T, D, R, S...>(values.data() + n, pitch);\n"
+			"    }\n"
+			"    TensorView<T const, D, R, S...> operator[](size_t n) const {\n"
+			"        return TensorView<T const, D, R, S...>(values.data() + n, pitch);\n"
+			"    }\n"
+			"    batch_type load(size_t n) const {\n"
+			"        batch_type batch;\n"
+			"        for (size_t k = 0; k < componentCount; k++) {\n"
+			"            batch.data()[k] = loadLanes<lanes>(component(k) + n);\n"
+			"        }\n"
+			"        return batch;\n"
+			"    }\n"
+			"    void store(batch_type const& batch, size_t n) {\n"
+			"        for (size_t k = 0; k < componentCount; k++) {\n"
+			"            storeLanes(batch.data()[k], component(k) + n);\n"
+			"        }\n"
+			"    }\n"
+			"private:\n"
+			"    static size_t paddedCount(size_t count) {\n"
+			"        return std::max(blockSize, (count + blockSize - 1) / blockSize * blockSize);\n"
+			"    }\n"
+			"    size_t cells;\n"
+			"    size_t pitch;\n"
+			"    std::vector<T, AlignedAllocator<T>> values;\n"
+			"};\n"
+			"\n"
+			"template<typename T, typename F, typename...Operands>\n"
+			"static void evaluateBatch(size_t n, T& result, F const& f, Operands const&...operands) {\n"
+			"    typename T::batch_type batch;\n"
+			"    f(batch, operands.load(n)...);\n"
+			"    result.store(batch, n);\n"
+			"}\n"
+			"\n"
+			"/*\n"
+			" * result[n] = f(operands[n]...) for every cell n, where f assigns its first argument, a TensorBatch, from TensorBatch\n"
+			" * operands, so that the expressions in f run on whole SIMD vectors of cells. The last batch includes padding cells.\n"
+			" */\n"
+			"template<typename T, size_t D, size_t R, auto...S, typename F, typename...Operands>\n"
+			"void evaluateField(SequentialPolicy, TensorField<T, D, R, S...>& result, F const& f, Operands const&...operands) {\n"
+			"    if (((operands.size() != result.size()) || ...)) {\n"
+			"        throw std::invalid_argument(\"All fields must have the same number of cells.\");\n"
+			"    }\n"
+			"    for (size_t n = 0; n < result.size(); n += result.lanes) {\n"
+			"        evaluateBatch(n, result, f, operands...);\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"/* Blocks of cells are scheduled exactly as the parallel constructor of TensorField zeroes them. */\n"
+			"template<typename T, size_t D, size_t R, auto...S, typename F, typename...Operands>\n"
+			"void evaluateField(ParallelPolicy, TensorField<T, D, R, S...>& result, F const& f, Operands const&...operands) {\n"
+			"    using Field = TensorField<T, D, R, S...>;\n"
+			"    if (((operands.size() != result.size()) || ...)) {\n"
+			"        throw std::invalid_argument(\"All fields must have the same number of cells.\");\n"
+			"    }\n"
+			"    ThreadPool::instance().parallelRange(result.blocks(), Field::blockGrain, [&](size_t begin, size_t end) {\n"
+			"        for (size_t n = begin * Field::blockSize; n < end * Field::blockSize; n += Field::lanes) {\n"
+			"            evaluateBatch(n, result, f, operands...);\n"
+			"        }\n"
+			"    });\n"
+			"}\n";
+	code.stringToFile(codeString);
+}
+
+void forwardDeclarations(CodeGen &code) {
+	code.newline();
+	code.print("template<size_t>");
+	code.print("struct Symmetry;");
+	code.newline();
+	code.print("template<size_t, auto...>");
+	code.print("struct Symmetries;");
+	code.newline();
+	code.print("template<char>");
+	code.print("struct Index;");
+	code.newline();
+	code.print("template<typename, size_t, size_t R, auto...S>");
+	code.print("struct Tensor;");
+	code.newline();
+	code.print("template<typename, size_t, size_t R, auto...S>");
+	code.print("struct TensorView;");
+	code.newline();
+	code.print("template<typename T, size_t D, size_t R, auto...S>");
+	code.print("TensorView(Tensor<T, D, R, S...>&) -> TensorView<T, D, R, S...>;");
+	code.newline();
+	code.print("template<typename T, size_t D, size_t R, auto...S>");
+	code.print("TensorView(Tensor<T, D, R, S...> const&) -> TensorView<T const, D, R, S...>;");
+	code.newline();
+	code.print("template<typename, size_t, size_t, typename, char...>");
+	code.print("struct TensorExpression;");
 	code.newline();
+	indexMapDeclaration(code);
+}
+
+void packedIndexHeader(CodeGen &code) {
+	const char *codeString =
+			"template<size_t N, size_t K>\n"
+			"static constexpr auto binomialTable = []() {\n"
+			"    std::array<std::array<size_t, K + 1>, N + 1> table = { };\n"
+			"    for (size_t n = 0; n <= N; n++) {\n"
+			"        table[n][0] = 1;\n"
+			"        for (size_t k = 1; k <= std::min(n, K); k++) {\n"
+			"            table[n][k] = table[n - 1][k - 1] + ((k < n) ? table[n - 1][k] : 0);\n"
+			"        }\n"
+			"    }\n"
+			"    return table;\n"
+			"}();\n"
+			"\n"
+			"template<size_t D, size_t R, auto...S>\n"
+			"static constexpr size_t blockSize(Symmetries<R, S...> const&, size_t b) {\n"
+			"    constexpr auto const& blocks = Symmetries<R, S...>::blocks;\n"
+			"    constexpr auto const& binomial = binomialTable<D + R, R>;\n"
+			"    size_t const k = blocks.sizes[b];\n"
+			"    return (blocks.signs[b] > 0) ? binomial[D + k - 1][k] : ((k <= D) ? binomial[D][k] : 0);\n"
+			"}\n"
+			"\n"
+			"template<size_t D, typename S>\n"
+			"static constexpr size_t packedSizeOf = []() {\n"
+			"    if constexpr (S::blocks.closedForm) {\n"
+			"        size_t size = 1;\n"
+			"        for (size_t b = 0; b < S::blocks.count; b++) {\n"
+			"            size *= blockSize<D>(S { }, b);\n"
+			"        }\n"
+			"        return size;\n"
+			"    } else {\n"
+			"        return std::get<2>(indexMapOf<D, S>);\n"
+			"    }\n"
+			"}();\n"
+			"\n"
+			"template<size_t N>\n"
+			"using PackedEntry = std::conditional_t<(N <= (size_t(1) << 6)), std::uint8_t, std::conditional_t<(N <= (size_t(1) << 14)), std::uint16_t,\n"
+			"        std::conditional_t<(N <= (size_t(1) << 30)), std::uint32_t, std::uint64_t>>>;\n"
+			"\n"
+			"template<size_t D, typename S>\n"
+			"static constexpr auto packedTableOf = []() {\n"
+			"    constexpr auto const& indexMap = indexMapOf<D, S>;\n"
+			"    using entry_type = PackedEntry<std::get<2>(indexMap)>;\n"
+			"    std::array<entry_type, std::get<0>(indexMap).size()> table = { };\n"
+			"    for (size_t i = 0; i < table.size(); i++) {\n"
+			"        int const sign = std::get<1>(indexMap)[i];\n"
+			"        size_t const index = sign ? std::get<0>(indexMap)[i] : 0;\n"
+			"        table[i] = entry_type((index << 2) | size_t(sign + 1));\n"
+			"    }\n"
+			"    return table;\n"
+			"}();\n"
+			"\n"
+			"/*\n"
+			" * Combinatorial-number-system rank of block B. Rather than sorting, each index counts the indices of its block that sort\n"
+			" * before it, which gives its sorted position; an antisymmetric block also counts the inversions, whose parity is the\n"
+			" * sign, and flags a repeated index. That is k^2 branch-free comparisons for a block of k slots, so O(R^2) per access in\n"
+			" * the worst case, against the D^R entries a lookup table would need.\n"
+			" */\n"
+			"template<size_t D, typename S, size_t B>\n"
+			"static constexpr size_t blockRank(std::array<size_t, S::Rank> const& indices, size_t& inversions, bool& repeated) {\n"
+			"    constexpr auto const& blocks = S::blocks;\n"
+			"    constexpr auto const& binomial = binomialTable<D + S::Rank, S::Rank>;\n"
+			"    constexpr size_t k = blocks.sizes[B];\n"
+			"    constexpr size_t const* slots = blocks.slots.data() + blocks.offsets[B];\n"
+			"    constexpr bool antisymmetric = blocks.signs[B] < 0;\n"
+			"    size_t rank = 0;\n"
+			"    for (size_t m = 0; m < k; m++) {\n"
+			"        size_t const x = indices[slots[m]];\n"
+			"        size_t position = 0;\n"
+			"        for (size_t n = 0; n < k; n++) {\n"
+			"            size_t const y = indices[slots[n]];\n"
+			"            position += (y < x) | ((y == x) & (n < m));\n"
+			"            if constexpr (antisymmetric) {\n"
+			"                inversions += (y > x) & (n < m);\n"
+			"                repeated |= (y == x) & (n < m);\n"
+			"            }\n"
+			"        }\n"
+			"        rank += antisymmetric ? binomial[x][position + 1] : binomial[x + position][position + 1];\n"
+			"    }\n"
+			"    return rank;\n"
+			"}\n"
+			"\n"
+			"/* Block ranks combined in mixed radix, with the sign from the parity of all antisymmetric inversions. No tables of D^R. */\n"
+			"template<size_t D, size_t R, auto...S>\n"
+			"static constexpr std::pair<size_t, int> closedFormIndex(Symmetries<R, S...> const&, std::array<size_t, R> const& indices) {\n"
+			"    using symmetries_type = Symmetries<R, S...>;\n"
+			"    size_t index = 0;\n"
+			"    size_t inversions = 0;\n"
+			"    bool repeated = false;\n"
+			"    [&]<size_t...B>(std::index_sequence<B...>) {\n"
+			"        ((index = index * blockSize<D>(symmetries_type { }, B) + blockRank<D, symmetries_type, B>(indices, inversions, repeated)), ...);\n"
+			"    }(std::make_index_sequence<symmetries_type::blocks.count>());\n"
+			"    int const sign = repeated ? 0 : ((inversions & 1) ? -1 : +1);\n"
+			"    return {repeated ? 0 : index, sign};\n"
+			"}\n"
+			"\n"
+			"template<size_t D, size_t R, auto...S>\n"
+			"static constexpr std::pair<size_t, int> packedIndex(Symmetries<R, S...> const& sym, std::array<size_t, R> const& indices) {\n"
+			"    using symmetries_type = Symmetries<R, S...>;\n"
+			"    size_t index = 0;\n"
+			"    if constexpr (!sizeof...(S)) {\n"
+			"        for (size_t r = 0; r < R; r++) {\n"
+			"            index = D * index + indices[r];\n"
+			"        }\n"
+			"        return {index, +1};\n"
+			"    } else if constexpr (symmetries_type::blocks.closedForm) {\n"
+			"        return closedFormIndex<D>(sym, indices);\n"
+			"    } else {\n"
+			"        constexpr auto const& table = packedTableOf<D, symmetries_type>;\n"
+			"        for (size_t r = 0; r < R; r++) {\n"
+			"            index = D * index + indices[r];\n"
+			"        }\n"
+			"        size_t const entry = table[index];\n"
+			"        return {entry >> 2, int(entry & 3) - 1};\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"/*\n"
+			" * Reference to a component of an antisymmetric tensor: the packed component it shares storage with and the sign from\n"
+			" * packedIndex. Reads scale by the sign and writes store the sign-corrected value. A zero component points at slot 0\n"
+			" * with sign 0, so it reads as an exact zero, never as V[0] * 0 (NaN for inf, -0 for negatives), and a write to it\n"
+			" * does not touch V[0] at all, so parallel writes through other components cannot race on it.\n"
+			" */\n"
+			"template<typename T>\n"
+			"struct SignedReference {\n"
+			"    T* value;\n"
+			"    int sign;\n"
+			"    constexpr operator T() const {\n"
+			"        return sign ? *value * T(sign) : T(0);\n"
+			"    }\n"
+			"    constexpr SignedReference const& operator=(T const& x) const {\n"
+			"        if (sign) {\n"
+			"            *value = T(sign) * x;\n"
+			"        }\n"
+			"        return *this;\n"
+			"    }\n"
+			"    constexpr SignedReference const& operator=(SignedReference const& other) const {\n"
+			"        return *this = T(other);\n"
+			"    }\n"
+			"    constexpr SignedReference const& operator+=(T const& x) const {\n"
+			"        return *this = T(*this) + x;\n"
+			"    }\n"
+			"    constexpr SignedReference const& operator-=(T const& x) const {\n"
+			"        return *this = T(*this) - x;\n"
+			"    }\n"
+			"    constexpr SignedReference const& operator*=(T const& x) const {\n"
+			"        return *this = T(*this) * x;\n"
+			"    }\n"
+			"    constexpr SignedReference const& operator/=(T const& x) const {\n"
+			"        return *this = T(*this) / x;\n"
+			"    }\n"
+			"};\n"
+			"\n"
+			"/* The component type behind an accessor result, which may be a SignedReference. */\n"
+			"template<typename T>\n"
+			"struct ComponentType {\n"
+			"    using type = T;\n"
+			"};\n"
+			"\n"
+			"template<typename T>\n"
+			"struct ComponentType<SignedReference<T>> {\n"
+			"    using type = T;\n"
+			"};\n"
+			"\n"
+			"template<typename T>\n"
+			"using component_type = typename ComponentType<std::remove_cvref_t<T>>::type;\n"
+			"\n"
+			"/* A signed component read through value, writable unless value points to const. */\n"
+			"template<typename T>\n"
+			"constexpr auto signedComponent(T* value, int sign) {\n"
+			"    if constexpr (std::is_const_v<T>) {\n"
+			"        using value_type = std::remove_const_t<T>;\n"
+			"        return sign ? value_type(*value * value_type(sign)) : value_type(0);\n"
+			"    } else {\n"
+			"        return SignedReference<T> { value, sign };\n"
+			"    }\n"
+			"}\n"
+			"\n"
+			"template<size_t D, typename S>\n"
+			"struct UniqueTuples {\n"
+			"    static constexpr size_t R = S::Rank;\n"
+			"    struct iterator {\n"
+			"        constexpr std::array<size_t, R> const& operator*() const {\n"
+			"            return tuple;\n"
+			"        }\n"
+			"        constexpr iterator& operator++() {\n"
+			"            constexpr auto const& blocks = S::blocks;\n"
+			"            count++;\n"
+			"            for (size_t b = blocks.count; b > 0; b--) {\n"
+			"                size_t const gap = (blocks.signs[b - 1] > 0) ? 0 : 1;\n"
+			"                size_t const* const slots = blocks.slots.data() + blocks.offsets[b - 1];\n"
+			"                size_t const k = blocks.sizes[b - 1];\n"
+			"                for (size_t m = 0; m < k; m++) {\n"
+			"                    size_t const next = (m + 1 < k) ? tuple[slots[m + 1]] : (D - 1 + gap);\n"
+			"                    if (tuple[slots[m]] + gap < next) {\n"
+			"                        tuple[slots[m]]++;\n"
+			"                        for (size_t n = 0; n < m; n++) {\n"
+			"                            tuple[slots[n]] = gap * n;\n"
+			"                        }\n"
+			"                        return *this;\n"
+			"                    }\n"
+			"                }\n"
+			"                for (size_t m = 0; m < k; m++) {\n"
+			"                    tuple[slots[m]] = gap * m;\n"
+			"                }\n"
+			"            }\n"
+			"            return *this;\n"
+			"        }\n"
+			"        constexpr bool operator!=(iterator const& other) const {\n"
+			"            return count != other.count;\n"
+			"        }\n"
+			"        size_t count;\n"
+			"        std::array<size_t, R> tuple;\n"
+			"    };\n"
+			"    constexpr auto begin() const {\n"
+			"        if constexpr (S::blocks.closedForm) {\n"
+			"            constexpr auto const& blocks = S::blocks;\n"
+			"            iterator first { 0, { } };\n"
+			"            for (size_t b = 0; b < blocks.count; b++) {\n"
+			"                for (size_t m = 0; m < blocks.sizes[b]; m++) {\n"
+			"                    first.tuple[blocks.slots[blocks.offsets[b] + m]] = (blocks.signs[b] > 0) ? 0 : m;\n"
+			"                }\n"
+			"            }\n"
+			"            return first;\n"
+			"        } else {\n"
+			"            return uniqueTuplesOf<D, S>.begin();\n"
+			"        }\n"
+			"    }\n"
+			"    /* Iterator to the k-th unique tuple, unranking the combinatorial number system of each block. */\n"
+			"    constexpr auto at(size_t k) const {\n"
+			"        if constexpr (S::blocks.closedForm) {\n"
+			"            constexpr auto const& blocks = S::blocks;\n"
+			"            constexpr auto const& binomial = binomialTable<D + R, R>;\n"
+			"            iterator it { k, { } };\n"
+			"            for (size_t b = blocks.count; b > 0; b--) {\n"
+			"                size_t const size = blockSize<D>(S { }, b - 1);\n"
+			"                size_t rank = k % size;\n"
+			"                k /= size;\n"
+			"                size_t const gap = (blocks.signs[b - 1] > 0) ? 1 : 0;\n"
+			"                size_t const* const slots = blocks.slots.data() + blocks.offsets[b - 1];\n"
+			"                size_t c = D + R;\n"
+			"                for (size_t m = blocks.sizes[b - 1]; m > 0; m--) {\n"
+			"                    while (binomial[c][m] > rank) {\n"
+			"                        c--;\n"
+			"                    }\n"
+			"                    rank -= binomial[c][m];\n"
+			"                    it.tuple[slots[m - 1]] = c - gap * (m - 1);\n"
+			"                }\n"
+			"            }\n"
+			"            return it;\n"
+			"        } else {\n"
+			"            return uniqueTuplesOf<D, S>.begin() + k;\n"
+			"        }\n"
+			"    }\n"
+			"    constexpr auto end() const {\n"
+			"        if constexpr (S::blocks.closedForm) {\n"
+			"            return iterator { packedSizeOf<D, S>, { } };\n"
+			"        } else {\n"
+			"            return uniqueTuplesOf<D, S>.end();\n"
+			"        }\n"
+			"    }\n"
+			"};\n";
+	code.stringToFile(codeString);
+}
+
+void helpers(CodeGen &code) {
+	code.newline();
+	code.print("template<char C>");
+	code.print("struct Index {");
+	code.indent();
+	code.print("static constexpr char value = C;");
+	code.dedent();
+	code.print("};");
+	indexMap2Header(code);
 	code.print("");
+	code.print("template<size_t R>");
+	code.print("struct Symmetry {");
+	code.indent();
+	code.print("int sign;");
+	code.print("std::array<size_t, R> values;");
+	code.print("static constexpr std::array<size_t, R> iota = [] {");
+	code.indent();
+	code.print("std::array<size_t, R> r = { };");
+	code.print("std::iota(r.begin(), r.end(), size_t(0));");
+	code.print("return r;");
+	code.dedent();
+	code.print("}();");
+	code.print("constexpr bool valid() const {");
+	code.indent();
+	code.print("return ((sign == +1) || (sign == -1)) && std::is_permutation(values.begin(), values.end(), iota.begin());");
+	code.dedent();
+	code.print("}");
+	code.dedent();
+	code.print("};");
+	code.newline();
+	code.print("template<size_t R, auto...I>");
+	code.print("struct Symmetries { ");
+	code.indent();
+	code.print("static constexpr size_t Rank = R;");
+	code.print("static constexpr size_t Size = sizeof...(I) / (size_t(1) + R);");
+	code.print("static_assert(Size * (R + size_t(1)) == sizeof...(I), \"Each symmetry is a sign followed by R slot indices.\");");
+	code.print("static constexpr auto symmetries = []() { ");
+	code.indent();
+	code.print("std::array<Symmetry<R>, Size> syms = { };");
+	code.print("constexpr size_t m = R + size_t(1);");
+	code.print("size_t i = 0;");
+	code.print("((((i % m == 0) ? void(syms[i / m].sign = int(I)) : void(syms[i / m].values[(i % m) - 1] = size_t(I))), i++), ...);");
+	code.print("return syms;");
+	code.dedent();
+	code.print("}();");
+	code.print("static_assert(std::all_of(symmetries.begin(), symmetries.end(), [](Symmetry<R> const& s) {");
+	code.indent();
+	code.print("return s.valid();");
+	code.dedent();
+	code.print("}), \"Invalid symmetry.\");");
+	code.print("static constexpr size_t Order = generateGroup(symmetries).size();");
+	code.print("static constexpr auto group = []() {");
+	code.indent();
+	code.print("std::array<Symmetry<R>, Order> elements = { };");
+	code.print("auto const closure = generateGroup(symmetries);");
+	code.print("std::copy(closure.begin(), closure.end(), elements.begin());");
+	code.print("return elements;");
+	code.dedent();
+	code.print("}();");
+	code.print("static constexpr SlotBlocks<R> blocks = slotBlocks(group);");
+	code.print("static constexpr bool hasAsymmetry = []() {");
+	code.indent();
+	code.print("bool rc = false;");
+	code.print("for (auto const& s : symmetries) {");
+	code.indent();
+	code.print("rc = (s.sign < 0) || rc;");
+	code.dedent();
+	code.print("}");
+	code.print("return rc;");
+	code.dedent();
+	code.print("}();");
+	code.dedent();
+	code.print("};");
+	code.newline();
+	code.print("template<size_t D, typename S>");
+	code.print("static constexpr auto indexMapOf = genIndexMap<D>(S{});");
+	code.newline();
+	code.print("template<size_t D, typename S>");
+	code.print("static constexpr auto uniqueTuplesOf = []<size_t R, auto...I>(Symmetries<R, I...>) {");
+	code.indent();
+	code.print("constexpr auto const& indexMap = indexMapOf<D, S>;");
+	code.print("return uniqueTuples<D, R, std::get<2>(indexMap), std::get<0>(indexMap).size()>(std::get<0>(indexMap), std::get<1>(indexMap));");
+	code.dedent();
+	code.print("}(S{});");
+	code.newline();
+	packedIndexHeader(code);
+	labelsHeader(code);
 }
 
 void includeFiles(CodeGen &code) {
 	code.print("#include <algorithm>");
 	code.print("#include <array>");
+	code.print("#include <atomic>");
+	code.print("#include <bit>");
 	code.print("#include <cmath>");
+	code.print("#include <condition_variable>");
 	code.print("#include <cstddef>");
+	code.print("#include <cstdint>");
+	code.print("#include <deque>");
+	code.print("#if __has_include(<experimental/simd>)");
+	code.print("#include <experimental/simd>");
+	code.print("#endif");
+	code.print("#include <functional>");
+	code.print("#include <limits>");
+	code.print("#include <mutex>");
+	code.print("#include <new>");
 	code.print("#include <numeric>");
 	code.print("#include <stdexcept>");
+	code.print("#include <thread>");
 	code.print("#include <tuple>");
+	code.print("#include <type_traits>");
 	code.print("#include <utility>");
+	code.print("#include <vector>");
 	code.newline();
 }
 
-std::string generate() {
-	CodeGen code;
-	code.print("#pragma once");
-	code.newline();
-	includeFiles(code);
-	code.newline();
-	code.print("namespace Tensors {");
-	code.newline();
+struct GeneratorOptions {
+	std::set<int> ranks;
+	std::vector<std::string> instances;
+	std::string output;
+	bool split = false;
+	bool slices = true;
+};
+
+static constexpr char const *const usage = "usage: codegen [--ranks=LIST] [--instance=TYPE:D:R[:S,...]]... [--split] [--no-slices] OUTPUT\n"
+		"   --ranks=LIST   ranks to generate, e.g. 0-4 or 2,3,6 (default 0-5)\n"
+		"   --instance=... explicitly instantiate Tensor<TYPE, D, R, S...>, e.g. double:3:2:+1,1,0\n"
+		"   --split        write one header per rank into the directory OUTPUT\n"
+		"   --no-slices    omit the 2^R - 2 accessors that mix Index and size_t arguments\n";
+
+std::set<int> parseRanks(std::string const &list) {
+	std::set<int> ranks;
+	size_t begin = 0;
+	while (begin < list.size()) {
+		size_t end = list.find(',', begin);
+		end = (end == std::string::npos) ? list.size() : end;
+		std::string const item = list.substr(begin, end - begin);
+		size_t const dash = item.find('-');
+		int const first = std::stoi(item.substr(0, dash));
+		int const last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+		if (first < 0 || last < first) {
+			throw std::invalid_argument("Invalid rank range \"" + item + "\".\n");
+		}
+		for (int r = first; r <= last; r++) {
+			ranks.insert(r);
+		}
+		begin = end + 1;
+	}
+	return ranks;
+}
+
+std::string instanceTypeString(std::string const &spec, int &rank) {
+	std::vector<std::string> fields;
+	size_t begin = 0;
+	while (begin <= spec.size()) {
+		size_t end = spec.find(':', begin);
+		end = (end == std::string::npos) ? spec.size() : end;
+		fields.push_back(spec.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	if (fields.size() < 3 || fields.size() > 4) {
+		throw std::invalid_argument("Invalid instance \"" + spec + "\".\n");
+	}
+	rank = std::stoi(fields[2]);
+	std::string str = "Tensor<" + fields[0] + ", " + std::to_string(std::stoul(fields[1])) + ", " + std::to_string(rank);
+	if (fields.size() == 4) {
+		size_t count = 0;
+		begin = 0;
+		while (begin < fields[3].size()) {
+			size_t end = fields[3].find(',', begin);
+			end = (end == std::string::npos) ? fields[3].size() : end;
+			str += ", " + fields[3].substr(begin, end - begin);
+			count++;
+			begin = end + 1;
+		}
+		if (count % (rank + 1)) {
+			throw std::invalid_argument("Each symmetry of \"" + spec + "\" needs a sign and " + std::to_string(rank) + " slots.\n");
+		}
+	}
+	str += ">";
+	return str;
+}
+
+GeneratorOptions parseOptions(int argc, char *argv[]) {
+	GeneratorOptions options;
+	bool ranksGiven = false;
+	for (int n = 1; n < argc; n++) {
+		std::string const arg = argv[n];
+		if (arg.rfind("--ranks=", 0) == 0) {
+			options.ranks = parseRanks(arg.substr(8));
+			ranksGiven = true;
+		} else if (arg.rfind("--instance=", 0) == 0) {
+			options.instances.push_back(arg.substr(11));
+		} else if (arg == "--split") {
+			options.split = true;
+		} else if (arg == "--no-slices") {
+			options.slices = false;
+		} else if (arg[0] != '-' && options.output.empty()) {
+			options.output = arg;
+		} else {
+			throw std::invalid_argument(std::string("Unrecognized argument \"") + arg + "\".\n" + usage);
+		}
+	}
+	if (options.output.empty()) {
+		throw std::invalid_argument(usage);
+	}
+	if (!ranksGiven) {
+		for (int r = 0; r <= ORDER; r++) {
+			options.ranks.insert(r);
+		}
+	}
+	for (auto const &instance : options.instances) {
+		int rank;
+		instanceTypeString(instance, rank);
+		options.ranks.insert(rank);
+	}
+	return options;
+}
+
+void generateCore(CodeGen &code) {
 	code.sectionComment("Forward Declarations");
 	forwardDeclarations(code);
 	code.newline();
 	code.sectionComment("Helper Classes");
 	helpers(code);
 	code.newline();
-	code.sectionComment("Tensor Declarations");
-	for (int r = 0; r <= ORDER; r++) {
-		TensorDeclaration(code, r);
-	}
-	code.sectionComment("Expression Declarations");
-	for (int r = 0; r <= ORDER; r++) {
-		expressionDeclaration(code, r);
-	}
+	code.sectionComment("Parallel Execution");
+	parallelImplementation(code);
+	code.newline();
+	code.sectionComment("Batched Tensors");
+	batchImplementation(code);
+	code.newline();
+	code.sectionComment("Matrix Multiplication");
+	gemmImplementation(code);
 	code.newline();
-	code.sectionComment("Tensor Implementations");
-	for (int r = 0; r <= ORDER; r++) {
-		TensorImplementation(code, r);
+	code.sectionComment("Tensor Fields");
+	fieldImplementation(code);
+	code.newline();
+	code.sectionComment("Reductions");
+	reductionImplementation(code);
+	code.newline();
+	code.sectionComment("Contractions");
+	contractionImplementation(code);
+	code.sectionComment("Element-wise Operations");
+	elementwiseImplementation(code);
+}
+
+/*
+ * Slices and contractions of a rank R tensor yield expressions of every lower rank, so the expression specializations up
+ * to the highest generated rank go with the core, while each rank keeps only its Tensor and TensorView.
+ */
+void generateExpressions(CodeGen &code, std::set<int> const &ranks) {
+	int const maxRank = ranks.empty() ? -1 : *ranks.rbegin();
+	for (int rank = 0; rank <= maxRank; rank++) {
+		code.sectionComment("Rank " + std::to_string(rank) + " Expressions");
+		expressionDeclaration(code, rank);
+		expressionImplementation(code, rank);
 	}
-	code.sectionComment("Expression Implementations");
-	for (int r = 0; r <= ORDER; r++) {
-		expressionImplementation(code, r);
+}
+
+void generateRank(CodeGen &code, int rank, bool slices) {
+	code.sectionComment("Rank " + std::to_string(rank) + " Declarations");
+	TensorDeclaration(code, rank, false, slices);
+	TensorDeclaration(code, rank, true, slices);
+	code.sectionComment("Rank " + std::to_string(rank) + " Implementations");
+	TensorImplementation(code, rank, false, slices);
+	TensorImplementation(code, rank, true, slices);
+}
+
+void generateInstances(CodeGen &code, std::vector<std::string> const &instances, bool definition) {
+	for (auto const &instance : instances) {
+		int rank;
+		code.print("%stemplate struct %s;", definition ? "" : "extern ", instanceTypeString(instance, rank));
 	}
 	code.newline();
-	code.print("}");
-	code.newline();
+}
+
+std::string rankSection(int rank, bool slices) {
+	CodeGen code;
+	generateRank(code, rank, slices);
 	return code.get();
 }
 
+template<typename F>
+void writeFile(std::filesystem::path const &path, F &&generator) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + path.string() + ".\n");
+	}
+	CodeGen code(file);
+	generator(code);
+	code.flush();
+	if (!file) {
+		throw std::runtime_error("Failed to write " + path.string() + ".\n");
+	}
+}
+
+void generate(GeneratorOptions const &options) {
+	std::vector<std::future<std::string>> ranks;
+	for (int r : options.ranks) {
+		ranks.push_back(std::async(std::launch::async, rankSection, r, options.slices));
+	}
+	writeFile(options.output, [&](CodeGen &code) {
+		code.print("#pragma once");
+		code.newline();
+		includeFiles(code);
+		code.newline();
+		code.print("namespace Tensors {");
+		code.newline();
+		generateCore(code);
+		generateExpressions(code, options.ranks);
+		for (auto &rank : ranks) {
+			code.splice(rank.get());
+		}
+		if (!options.instances.empty()) {
+			code.sectionComment("Instantiations");
+			generateInstances(code, options.instances, false);
+		}
+		code.print("}");
+		code.newline();
+	});
+}
+
+void generateSplit(GeneratorOptions const &options) {
+	std::filesystem::path const directory = options.output;
+	std::filesystem::create_directories(directory);
+	std::vector<std::future<void>> files;
+	bool const slices = options.slices;
+	for (int r : options.ranks) {
+		files.push_back(std::async(std::launch::async, [directory, r, slices]() {
+			writeFile(directory / ("TensorRank" + std::to_string(r) + ".hpp"), [r, slices](CodeGen &code) {
+				code.print("#pragma once");
+				code.newline();
+				code.print("#include \"TensorCore.hpp\"");
+				code.newline();
+				code.print("namespace Tensors {");
+				code.newline();
+				generateRank(code, r, slices);
+				code.print("}");
+				code.newline();
+			});
+		}));
+	}
+	writeFile(directory / "TensorCore.hpp", [&](CodeGen &code) {
+		code.print("#pragma once");
+		code.newline();
+		includeFiles(code);
+		code.newline();
+		code.print("namespace Tensors {");
+		code.newline();
+		generateCore(code);
+		generateExpressions(code, options.ranks);
+		code.print("}");
+		code.newline();
+	});
+	writeFile(directory / "Tensor.hpp", [&](CodeGen &code) {
+		code.print("#pragma once");
+		code.newline();
+		for (int r : options.ranks) {
+			code.print("#include \"TensorRank%i.hpp\"", r);
+		}
+	});
+	if (!options.instances.empty()) {
+		writeFile(directory / "TensorInstances.hpp", [&](CodeGen &code) {
+			code.print("#pragma once");
+			code.newline();
+			code.print("#include \"Tensor.hpp\"");
+			code.newline();
+			code.print("namespace Tensors {");
+			code.newline();
+			generateInstances(code, options.instances, false);
+			code.print("}");
+		});
+		writeFile(directory / "TensorInstances.cpp", [&](CodeGen &code) {
+			code.print("#include \"Tensor.hpp\"");
+			code.newline();
+			code.print("namespace Tensors {");
+			code.newline();
+			generateInstances(code, options.instances, true);
+			code.print("}");
+		});
+	}
+	for (auto &file : files) {
+		file.get();
+	}
+}
+
 int main(int argc, char *argv[]) {
 //	for (int rank = 2; rank <= ORDER + 1; rank++) {
 //		auto const syms = possibleSymmetries(rank);
@@ -821,17 +2956,14 @@ int main(int argc, char *argv[]) {
 
 	int rc = -1;
 	try {
-		if (argc >= 2) {
-			std::ofstream file(argv[1]);
-			if (file.is_open()) {
-				file << generate();
-				std::cout << "Code generation successful.\n";
-				rc = 0;
-			}
-		}
-		if (rc != 0) {
-			throw std::runtime_error("Failed to open the file.\n");
+		auto const options = parseOptions(argc, argv);
+		if (options.split) {
+			generateSplit(options);
+		} else {
+			generate(options);
 		}
+		std::cout << "Code generation successful.\n";
+		rc = 0;
 	} catch (const std::exception &exception) {
 		std::cerr << exception.what() << std::endl;
 	}
@@ -0,0 +1,162 @@
+/*
+ * Check of a split header for the highest supported rank. Index labels a..h of the rank-8 expressions must not
+ * collide with any template parameter of the generated members, so every generated entry point is instantiated once,
+ * and each result is compared with the same operation done by hand on dense arrays. TensorRank8.hpp includes only
+ * TensorCore.hpp, which must still carry the lower-rank expressions of the contraction.
+ */
+#include "TensorRank8.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+using namespace Tensors;
+
+static constexpr size_t D = 2;
+static constexpr size_t R = 8;
+static constexpr size_t count = size_t(1) << R;
+
+using tuple_type = std::array<size_t, R>;
+
+static tuple_type tupleOf(size_t n) {
+	tuple_type indices;
+	for (size_t r = R; r > 0; r--) {
+		indices[r - 1] = n % D;
+		n /= D;
+	}
+	return indices;
+}
+
+static size_t flatIndex(tuple_type const &indices) {
+	size_t n = 0;
+	for (size_t r = 0; r < R; r++) {
+		n = D * n + indices[r];
+	}
+	return n;
+}
+
+static size_t swapFirst(size_t n) {
+	tuple_type indices = tupleOf(n);
+	std::swap(indices[0], indices[1]);
+	return flatIndex(indices);
+}
+
+static size_t reverse(size_t n) {
+	tuple_type const indices = tupleOf(n);
+	return flatIndex(tuple_type { indices[7], indices[6], indices[5], indices[4], indices[3], indices[2], indices[1], indices[0] });
+}
+
+template<typename T, size_t ...N>
+static decltype(auto) at(T &tensor, tuple_type const &indices, std::index_sequence<N...>) {
+	return tensor(indices[N]...);
+}
+
+template<typename T>
+static decltype(auto) at(T &tensor, size_t n) {
+	return at(tensor, tupleOf(n), std::make_index_sequence<R> { });
+}
+
+static bool failed = false;
+
+/* Small integers throughout, so every sum below is exact. */
+template<typename T>
+static void expect(T const &tensor, std::vector<double> const &reference, char const *what) {
+	for (size_t n = 0; n < count; n++) {
+		if (at(tensor, n) != reference[n]) {
+			std::fprintf(stderr, "rankcheck: %s differs from the dense loop at component %zu\n", what, n);
+			failed = true;
+			return;
+		}
+	}
+}
+
+static void expect(double value, double reference, char const *what) {
+	if (value != reference) {
+		std::fprintf(stderr, "rankcheck: %s is %g, the dense loop gives %g\n", what, value, reference);
+		failed = true;
+	}
+}
+
+int main() {
+	Index<'a'> a;
+	Index<'b'> b;
+	Index<'c'> c;
+	Index<'d'> d;
+	Index<'e'> e;
+	Index<'f'> f;
+	Index<'g'> g;
+	Index<'h'> h;
+	Tensor<double, 2, 8> A;
+	Tensor<double, 2, 8, 1, 1, 0, 2, 3, 4, 5, 6, 7> B;
+	Tensor<double, 2, 8> C;
+	std::vector<double> denseA(count);
+	std::vector<double> denseB(count);
+	std::vector<double> denseC(count);
+	for (size_t n = 0; n < count; n++) {
+		denseA[n] = double((37 * n) % 101) - 50.0;
+		at(A, n) = denseA[n];
+	}
+	expect(A, denseA, "element access");
+
+	B(a, b, c, d, e, f, g, h) = A(a, b, c, d, e, f, g, h) + A(b, a, c, d, e, f, g, h);
+	for (size_t n = 0; n < count; n++) {
+		denseB[n] = denseA[n] + denseA[swapFirst(n)];
+	}
+	expect(B, denseB, "symmetric assignment");
+
+	C(a, b, c, d, e, f, g, h) = B(h, g, f, e, d, c, b, a);
+	for (size_t n = 0; n < count; n++) {
+		denseC[n] = denseB[reverse(n)];
+	}
+	expect(C, denseC, "permuted assignment");
+
+	C(a, b, c, d, e, f, g, h).assign(seq, A(a, b, c, d, e, f, g, h));
+	expect(C, denseA, "sequential assign");
+
+	C(a, b, c, d, e, f, g, h).assign(par, A(b, a, c, d, e, f, g, h));
+	for (size_t n = 0; n < count; n++) {
+		denseC[n] = denseA[swapFirst(n)];
+	}
+	expect(C, denseC, "parallel assign");
+
+	TensorView<double, 2, 8> const view(A);
+	view(a, b, c, d, e, f, g, h) = C(a, b, c, d, e, f, g, h);
+	denseA = denseC;
+	expect(A, denseA, "view assignment");
+	expect(view, denseA, "view access");
+
+	double full = 0.0;
+	double reversed = 0.0;
+	double symmetric = 0.0;
+	for (size_t n = 0; n < count; n++) {
+		full += denseA[n] * denseC[n];
+		reversed += denseA[n] * denseC[reverse(n)];
+		symmetric += denseB[n] * denseC[n];
+	}
+	expect(A(a, b, c, d, e, f, g, h) * C(a, b, c, d, e, f, g, h), full, "full contraction");
+	expect(A(a, b, c, d, e, f, g, h) * C(h, g, f, e, d, c, b, a), reversed, "reversed contraction");
+	expect(B(a, b, c, d, e, f, g, h) * C(a, b, c, d, e, f, g, h), symmetric, "symmetric contraction");
+
+	/* Components with a repeated antisymmetric index share slot 0 with sign 0: they read as zero and ignore stores. */
+	Tensor<double, 2, 8, -1, 1, 0, 2, 3, 4, 5, 6, 7> E;
+	std::vector<double> denseE(count);
+	for (size_t n = 0; n < E.size(); n++) {
+		E.data()[n] = double(n + 1);
+	}
+	for (size_t n = 0; n < count; n++) {
+		denseE[n] = at(std::as_const(E), n);
+		expect(at(E, n), denseE[n], "antisymmetric reference read");
+	}
+	for (size_t n = 0; n < count; n++) {
+		expect(denseE[swapFirst(n)], -denseE[n], "antisymmetric sign");
+		if (tupleOf(n)[0] == tupleOf(n)[1]) {
+			expect(denseE[n], 0.0, "zero component read");
+			at(E, n) = 5.0;
+		}
+	}
+	expect(E.data()[0], 1.0, "slot 0 after zero component stores");
+	expect(E, denseE, "antisymmetric access");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+/*
+ * Checks of the generated Tensor.hpp paths that rankcheck does not reach: reductions over batched tensors, parallel
+ * assignment above parallelThreshold, the tiled, GEMM and planned contractions above tiledContractionThreshold, and
+ * TensorField and forEachIndex on the thread pool. Every result is compared with the same operation done by hand on
+ * dense arrays or on the lanes one at a time.
+ */
+#include "Tensor.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace Tensors;
+
+static bool failed = false;
+
+/* Small integers throughout, so every sum below is exact. */
+static void expect(double value, double reference, char const *what) {
+	if (value != reference) {
+		std::fprintf(stderr, "tensorcheck: %s is %g, the dense loop gives %g\n", what, value, reference);
+		failed = true;
+	}
+}
+
+template<typename T>
+static void fillRank2(T &tensor, std::vector<double> &dense, size_t D, size_t seed) {
+	for (size_t n = 0; n < tensor.size(); n++) {
+		tensor.data()[n] = double((seed + 5 * n) % 11) - 5.0;
+	}
+	T const &source = tensor;
+	for (size_t i = 0; i < D; i++) {
+		for (size_t j = 0; j < D; j++) {
+			dense[D * i + j] = source(i, j);
+		}
+	}
+}
+
+/* dot and sum of a batch weigh each packed component by its multiplicity in every lane at once. */
+template<int Sign>
+static void checkBatchReductions(char const *what) {
+	constexpr size_t D = 3;
+	constexpr size_t W = 4;
+	using tensor_type = Tensor<double, D, 2, Sign, 1, 0>;
+	TensorBatch<double, W, D, 2, Sign, 1, 0> A;
+	TensorBatch<double, W, D, 2, Sign, 1, 0> B;
+	std::array<double, W> denseDot = { };
+	std::array<double, W> denseSum = { };
+	for (size_t w = 0; w < W; w++) {
+		tensor_type a;
+		tensor_type b;
+		std::vector<double> denseA(D * D);
+		std::vector<double> denseB(D * D);
+		fillRank2(a, denseA, D, w);
+		fillRank2(b, denseB, D, 3 * w + 1);
+		insertLane(A, w, a);
+		insertLane(B, w, b);
+		for (size_t n = 0; n < D * D; n++) {
+			denseDot[w] += denseA[n] * denseB[n];
+			denseSum[w] += denseA[n];
+		}
+		expect(dot(a, b), denseDot[w], what);
+		expect(sum(a), denseSum[w], what);
+	}
+	auto const batchDot = dot(A, B);
+	auto const batchSum = sum(A);
+	for (size_t w = 0; w < W; w++) {
+		expect(batchDot[w], denseDot[w], what);
+		expect(batchSum[w], denseSum[w], what);
+	}
+}
+
+/* Rank-4 symmetric at D = 64 has 766480 unique components, well above parallelThreshold, so par runs on the pool. */
+static void checkParallelAssign() {
+	constexpr size_t D = 64;
+	using tensor_type = Tensor<double, D, 4, 1, 1, 0, 2, 3, 1, 0, 2, 1, 3, 1, 0, 1, 3, 2>;
+	static_assert(tensor_type::size() >= parallelThreshold);
+	auto const A = std::make_unique<tensor_type>();
+	auto const B = std::make_unique<tensor_type>();
+	auto const sequential = std::make_unique<tensor_type>();
+	auto const parallel = std::make_unique<tensor_type>();
+	for (size_t n = 0; n < tensor_type::size(); n++) {
+		A->data()[n] = double(n % 13);
+		B->data()[n] = double(n % 7) - 3.0;
+	}
+	Index<'a'> a;
+	Index<'b'> b;
+	Index<'c'> c;
+	Index<'d'> d;
+	(*sequential)(a, b, c, d).assign(seq, std::as_const(*A)(a, b, c, d) + std::as_const(*B)(d, c, b, a));
+	(*parallel)(a, b, c, d).assign(par, std::as_const(*A)(a, b, c, d) + std::as_const(*B)(d, c, b, a));
+	for (size_t n = 0; n < tensor_type::size(); n++) {
+		expect(sequential->data()[n], A->data()[n] + B->data()[n], "sequential assign");
+		expect(parallel->data()[n], sequential->data()[n], "parallel assign");
+		if (failed) {
+			return;
+		}
+	}
+}
+
+/* C(i, j, m, n) = X(i, j, k, l) * Y(k, l, m, n) with dense loops, X and Y given densely. */
+template<typename T>
+static std::vector<T> denseProduct(std::vector<T> const &X, std::vector<T> const &Y, size_t M, size_t K, size_t N) {
+	std::vector<T> C(M * N, T(0));
+	for (size_t m = 0; m < M; m++) {
+		for (size_t k = 0; k < K; k++) {
+			for (size_t n = 0; n < N; n++) {
+				C[N * m + n] += X[K * m + k] * Y[N * k + n];
+			}
+		}
+	}
+	return C;
+}
+
+template<typename T, size_t D>
+static void expectRank4(Tensor<T, D, 4> const &C, std::vector<T> const &reference, char const *what) {
+	for (size_t n = 0; n < C.size(); n++) {
+		if (C.data()[n] != reference[n]) {
+			std::fprintf(stderr, "tensorcheck: %s differs from the dense loop at component %zu\n", what, n);
+			failed = true;
+			return;
+		}
+	}
+}
+
+/*
+ * At D = 8 the rank-4 by rank-4 product is 64 x 64 x 64, above tiledContractionThreshold: dense double operands run on
+ * the GEMM micro-kernel, a symmetric operand is gathered through its accessor, and an integer product on the panel loop.
+ */
+template<typename T, bool Symmetric>
+static void checkTiledContraction(char const *what) {
+	constexpr size_t D = 8;
+	constexpr size_t P = D * D;
+	using left_type = std::conditional_t<Symmetric, Tensor<T, D, 4, 1, 1, 0, 2, 3>, Tensor<T, D, 4>>;
+	auto const X = std::make_unique<left_type>();
+	auto const Y = std::make_unique<Tensor<T, D, 4>>();
+	auto const C = std::make_unique<Tensor<T, D, 4>>();
+	std::vector<T> denseX(P * P);
+	std::vector<T> denseY(P * P);
+	for (size_t n = 0; n < X->size(); n++) {
+		X->data()[n] = T(n % 5) - T(2);
+	}
+	for (size_t n = 0; n < P * P; n++) {
+		Y->data()[n] = denseY[n] = T(n % 9) - T(4);
+		denseX[n] = std::as_const(*X)(n / (P * D), n / P % D, n / D % D, n % D);
+	}
+	Index<'i'> i;
+	Index<'j'> j;
+	Index<'k'> k;
+	Index<'l'> l;
+	Index<'m'> m;
+	Index<'n'> n;
+	(*C)(i, j, m, n) = std::as_const(*X)(i, j, k, l) * std::as_const(*Y)(k, l, m, n);
+	expectRank4(*C, denseProduct(denseX, denseY, P, P, P), what);
+}
+
+/* At D = 16 the matrix-vector product is 4096 x 1 x 16, tiled but narrower than a register block. */
+static void checkMatrixVector() {
+	constexpr size_t D = 16;
+	constexpr size_t M = D * D * D;
+	auto const X = std::make_unique<Tensor<double, D, 4>>();
+	auto const C = std::make_unique<Tensor<double, D, 3>>();
+	Tensor<double, D, 1> v;
+	std::vector<double> denseX(M * D);
+	std::vector<double> denseV(D);
+	for (size_t n = 0; n < M * D; n++) {
+		X->data()[n] = denseX[n] = double(n % 7) - 3.0;
+	}
+	for (size_t d = 0; d < D; d++) {
+		v(d) = denseV[d] = double(d) - 8.0;
+	}
+	Index<'i'> i;
+	Index<'j'> j;
+	Index<'k'> k;
+	Index<'l'> l;
+	(*C)(i, j, k) = std::as_const(*X)(i, j, k, l) * std::as_const(v)(l);
+	std::vector<double> const reference = denseProduct(denseX, denseV, M, D, 1);
+	for (size_t n = 0; n < M; n++) {
+		expect(C->data()[n], reference[n], "matrix-vector contraction");
+	}
+}
+
+/* At D = 64 the chains are planned pairwise instead of summing every label per component. */
+static void checkPlannedContraction() {
+	constexpr size_t D = 64;
+	using matrix_type = Tensor<double, D, 2>;
+	auto const A = std::make_unique<matrix_type>();
+	auto const B = std::make_unique<matrix_type>();
+	auto const C = std::make_unique<matrix_type>();
+	auto const result = std::make_unique<matrix_type>();
+	Tensor<double, D, 1> v;
+	Tensor<double, D, 1> w;
+	std::vector<double> denseA(D * D);
+	std::vector<double> denseB(D * D);
+	std::vector<double> denseC(D * D);
+	std::vector<double> denseV(D);
+	for (size_t n = 0; n < D * D; n++) {
+		A->data()[n] = denseA[n] = double(n % 5) - 2.0;
+		B->data()[n] = denseB[n] = double(n % 3) - 1.0;
+		C->data()[n] = denseC[n] = double(n % 7) - 3.0;
+	}
+	for (size_t d = 0; d < D; d++) {
+		v(d) = denseV[d] = double(d % 4) - 1.0;
+	}
+	Index<'i'> i;
+	Index<'j'> j;
+	Index<'k'> k;
+	Index<'l'> l;
+	auto const &a = std::as_const(*A);
+	auto const &b = std::as_const(*B);
+	auto const &c = std::as_const(*C);
+	static_assert(contractionPlanOf<decltype(a(i, j) * b(j, k) * c(k, l))>.flops < contractionPlanOf<decltype(a(i, j) * b(j, k) * c(k, l))>.lazyFlops);
+	(*result)(l, i) = a(i, j) * b(j, k) * c(k, l);
+	std::vector<double> const ABC = denseProduct(denseProduct(denseA, denseB, D, D, D), denseC, D, D, D);
+	for (size_t n = 0; n < D * D; n++) {
+		expect(result->data()[n], ABC[D * (n % D) + n / D], "planned matrix chain");
+	}
+	w(i) = a(i, j) * b(j, k) * c(k, l) * std::as_const(v)(l);
+	std::vector<double> const ABCv = denseProduct(ABC, denseV, D, D, 1);
+	for (size_t d = 0; d < D; d++) {
+		expect(w(d), ABCv[d], "planned matrix chain times a vector");
+	}
+}
+
+/* out(i, j) = x(i, k) * y(k, j) + x(i, j) on every cell, sequentially and on the pool, over a count that is not a whole batch. */
+template<typename Policy>
+static void checkField(Policy const &policy, char const *what) {
+	constexpr size_t D = 3;
+	constexpr size_t cells = 100003;
+	TensorField<double, D, 2, 1, 1, 0> X(policy, cells);
+	TensorField<double, D, 2> Y(policy, cells);
+	TensorField<double, D, 2> Z(policy, cells);
+	for (size_t n = 0; n < cells; n++) {
+		auto x = X[n];
+		auto y = Y[n];
+		for (size_t i = 0; i < D; i++) {
+			for (size_t j = 0; j < D; j++) {
+				x(i, j) = double((n + i + j) % 5);
+				y(i, j) = double((n + 3 * i + j) % 7) - 3.0;
+			}
+		}
+	}
+	evaluateField(policy, Z, [](auto &out, auto const &x, auto const &y) {
+		Index<'i'> i;
+		Index<'j'> j;
+		Index<'k'> k;
+		out(i, j) = x(i, k) * y(k, j) + x(i, j);
+	}, X, Y);
+	for (size_t n = 0; n < cells; n++) {
+		auto const x = std::as_const(X)[n];
+		auto const y = std::as_const(Y)[n];
+		auto const z = std::as_const(Z)[n];
+		for (size_t i = 0; i < D; i++) {
+			for (size_t j = 0; j < D; j++) {
+				double reference = x(i, j);
+				for (size_t k = 0; k < D; k++) {
+					reference += x(i, k) * y(k, j);
+				}
+				expect(z(i, j), reference, what);
+			}
+		}
+		if (failed) {
+			return;
+		}
+	}
+}
+
+/* The cost of f grows with n modulo 4096, so the shares of the threads are uneven and work has to be stolen. */
+static void checkForEachIndex() {
+	constexpr size_t count = size_t(1) << 20;
+	std::vector<std::uint64_t> values(count);
+	forEachIndex(par, count, [&values](size_t n) {
+		std::uint64_t total = 0;
+		for (size_t m = 0; m <= n % 4096; m++) {
+			total += m;
+		}
+		values[n] = total;
+	});
+	for (size_t n = 0; n < count; n++) {
+		std::uint64_t const m = n % 4096;
+		if (values[n] != m * (m + 1) / 2) {
+			std::fprintf(stderr, "tensorcheck: forEachIndex differs from the dense loop at index %zu\n", n);
+			failed = true;
+			return;
+		}
+	}
+}
+
+int main() {
+	checkBatchReductions<+1>("symmetric batch reduction");
+	checkBatchReductions<-1>("antisymmetric batch reduction");
+	checkParallelAssign();
+	checkTiledContraction<double, false>("GEMM contraction");
+	checkTiledContraction<double, true>("symmetric GEMM contraction");
+	checkTiledContraction<std::int64_t, false>("integer tiled contraction");
+	checkMatrixVector();
+	checkPlannedContraction();
+	checkField(seq, "sequential field");
+	checkField(par, "parallel field");
+	checkForEachIndex();
+	return failed ? 1 : 0;
+}